@@ -0,0 +1,12 @@
+#version 120
+
+uniform sampler2D tex;
+
+varying vec2 texCoord;
+varying vec4 color;
+
+void main (void) {
+    
+    gl_FragColor = texture2D(tex, texCoord) * color;
+    
+}
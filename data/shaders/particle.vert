@@ -0,0 +1,27 @@
+#version 120
+
+// Per-instance attributes: xyz = position, w = size in pixels
+attribute vec4 instancePosSize;
+// Normalized particle age, 0 at birth and 1 at the end of its life
+attribute float instanceLife;
+
+uniform vec2 viewportSize;
+uniform vec4 tint;
+
+varying vec2 texCoord;
+varying vec4 color;
+
+void main() {
+
+    // gl_Vertex.xy is the quad corner in [-1, 1]. Offset it in clip space so the
+    // quad keeps a constant size in pixels, just like a point sprite.
+    vec4 clip     = gl_ModelViewProjectionMatrix * vec4(instancePosSize.xyz, 1.0);
+    clip.xy      += gl_Vertex.xy * instancePosSize.w / viewportSize * clip.w;
+    gl_Position   = clip;
+
+    texCoord      = gl_Vertex.xy * 0.5 + 0.5;
+
+    // Particles darken to a quarter of their brightness over their lifespan
+    color         = vec4(tint.rgb * mix(1.0, 0.25, instanceLife), tint.a);
+
+}
@@ -0,0 +1,17 @@
+#version 300 es
+
+// define default precision for float, vec, mat.
+precision highp float;
+
+uniform sampler2D tex;
+
+in vec2 texCoord;
+in vec4 color;
+
+out vec4 fragColor;
+
+void main (void) {
+    
+    fragColor = texture(tex, texCoord) * color;
+    
+}
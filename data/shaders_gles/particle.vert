@@ -0,0 +1,34 @@
+#version 300 es
+
+// define default precision for float, vec, mat.
+precision highp float;
+
+uniform mat4 modelViewProjectionMatrix;
+
+in vec4 position;
+
+// Per-instance attributes: xyz = position, w = size in pixels
+in vec4 instancePosSize;
+// Normalized particle age, 0 at birth and 1 at the end of its life
+in float instanceLife;
+
+uniform vec2 viewportSize;
+uniform vec4 tint;
+
+out vec2 texCoord;
+out vec4 color;
+
+void main() {
+
+    // position.xy is the quad corner in [-1, 1]. Offset it in clip space so the
+    // quad keeps a constant size in pixels, just like a point sprite.
+    vec4 clip     = modelViewProjectionMatrix * vec4(instancePosSize.xyz, 1.0);
+    clip.xy      += position.xy * instancePosSize.w / viewportSize * clip.w;
+    gl_Position   = clip;
+
+    texCoord      = position.xy * 0.5 + 0.5;
+
+    // Particles darken to a quarter of their brightness over their lifespan
+    color         = vec4(tint.rgb * mix(1.0, 0.25, instanceLife), tint.a);
+
+}
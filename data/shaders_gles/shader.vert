@@ -3,6 +3,8 @@ void main() {
     gl_Position   = gl_ModelViewProjectionMatrix * gl_Vertex;
 	float size    = gl_Normal.x;
     gl_PointSize  = size;
-    gl_FrontColor = gl_Color;
+    // gl_Normal.y holds the normalized particle age; darken towards a quarter
+    // of the original brightness over the particle's lifespan
+    gl_FrontColor = vec4(gl_Color.rgb * mix(1.0, 0.25, gl_Normal.y), gl_Color.a);
 
 }
\ No newline at end of file
@@ -0,0 +1,98 @@
+#include "AssetLoader.h"
+
+// Queue work for the thread pool; finish, if given, runs afterwards on the main thread
+void AssetLoader::addTask(const string& name, function<void()> work, function<void()> finish) {
+	Task task;
+	task.name = name;
+	task.work = work;
+	task.finish = finish;
+	numTasks++;
+
+	{
+		lock_guard<mutex> lock(queueMutex);
+		workQueue.push_back(task);
+	}
+	queueCondition.notify_one();
+}
+
+// Queue work that must run on the main thread
+void AssetLoader::addMainTask(const string& name, function<void()> work) {
+	Task task;
+	task.name = name;
+	task.work = work;
+	numTasks++;
+	mainQueue.push_back(task);
+}
+
+void AssetLoader::start(int numThreads) {
+	bStop = false;
+	for (int i = 0; i < max(numThreads, 1); i++) {
+		workers.push_back(thread(&AssetLoader::threadedFunction, this));
+	}
+}
+
+void AssetLoader::stop() {
+	{
+		lock_guard<mutex> lock(queueMutex);
+		bStop = true;
+		workQueue.clear();
+	}
+	queueCondition.notify_all();
+	for (int i = 0; i < workers.size(); i++) {
+		workers[i].join();
+	}
+	workers.clear();
+}
+
+void AssetLoader::threadedFunction() {
+	while (true) {
+		Task task;
+		{
+			unique_lock<mutex> lock(queueMutex);
+			queueCondition.wait(lock, [this] { return bStop || workQueue.size() > 0; });
+			if (bStop) return;
+			task = workQueue.front();
+			workQueue.pop_front();
+		}
+
+		task.work();
+
+		lock_guard<mutex> lock(queueMutex);
+		finishQueue.push_back(task);
+	}
+}
+
+/* update() is called once per frame on the main thread. It runs the finish steps of
+ * completed worker tasks and at most one main task, and returns true once every
+ * queued task is done. Tasks may queue further tasks while they run. */
+bool AssetLoader::update() {
+	deque<Task> finished;
+	{
+		lock_guard<mutex> lock(queueMutex);
+		finished.swap(finishQueue);
+	}
+	for (int i = 0; i < finished.size(); i++) {
+		if (finished[i].finish) {
+			finished[i].finish();
+		}
+		numDone++;
+	}
+
+	if (mainQueue.size() > 0) {
+		Task task = mainQueue.front();
+		mainQueue.pop_front();
+		currentTask = task.name;
+		task.work();
+		numDone++;
+	}
+	else {
+		lock_guard<mutex> lock(queueMutex);
+		currentTask = workQueue.size() > 0 ? workQueue.front().name : "";
+	}
+
+	if (isDone()) {
+		stop();
+		return true;
+	}
+	return false;
+}
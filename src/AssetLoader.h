@@ -0,0 +1,46 @@
+#pragma once
+
+#include "ofMain.h"
+#include <condition_variable>
+#include <deque>
+
+// AssetLoader runs the start-up work while the app keeps drawing frames. Worker
+// tasks (file decoding, octree construction) run in parallel on a thread pool and
+// may hand a finish step back to the main thread for GL uploads. Main tasks, for
+// anything that has to touch GL or the sound system, run on the main thread one
+// per update() so the progress screen stays responsive.
+class AssetLoader {
+private:
+	struct Task {
+		string name;
+		function<void()> work;
+		function<void()> finish;
+	};
+
+	void threadedFunction();
+
+	vector<thread> workers;
+	mutex queueMutex;
+	condition_variable queueCondition;
+	deque<Task> workQueue;
+	deque<Task> finishQueue;
+	deque<Task> mainQueue;
+	bool bStop = false;
+
+	int numTasks = 0;
+	int numDone = 0;
+	string currentTask;
+public:
+	~AssetLoader() { stop(); }
+
+	void addTask(const string& name, function<void()> work, function<void()> finish = nullptr);
+	void addMainTask(const string& name, function<void()> task);
+
+	void start(int numThreads);
+	void stop();
+	bool update();
+
+	float getProgress() const { return numTasks > 0 ? (float)numDone / numTasks : 1.0f; }
+	const string& getCurrentTask() const { return currentTask; }
+	bool isDone() const { return numDone == numTasks; }
+};
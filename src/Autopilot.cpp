@@ -0,0 +1,268 @@
+#include "Autopilot.h"
+#include "Sensors.h"
+#include "Profiler.h"
+#include <atomic>
+#include <cfloat>
+
+// Inputs the planner chooses from: up, down or neither, combined with one of the
+// horizontal thrusters or none. The autopilot never turns the lander.
+static const uint32_t verticalInputs[] = { 0, INPUT_THRUST_UP, INPUT_THRUST_DOWN };
+static const uint32_t horizontalInputs[] = { 0, INPUT_FORWARD, INPUT_BACKWARD, INPUT_LEFT, INPUT_RIGHT };
+
+static uint32_t randomInput(SimRandom& random) {
+	return verticalInputs[random.next() % 3] | horizontalInputs[random.next() % 5];
+}
+
+void Autopilot::begin(const Simulation& sim) {
+	best.assign(numSegments, 0);
+	candidates.assign(numCandidates * numSegments, 0);
+	costs.assign(numCandidates, 0);
+	tickInSegment = 0;
+	target = -1;
+	random.setSeed(sim.rng.state);
+}
+
+Controller* Autopilot::clone() const {
+	Autopilot* copy = new Autopilot();
+	copy->numSegments = numSegments;
+	copy->segmentTicks = segmentTicks;
+	copy->numCandidates = numCandidates;
+	copy->jobs = jobs;
+	copy->budgetMicros = budgetMicros;
+	copy->fuelWeight = fuelWeight;
+	copy->cruiseHeight = cruiseHeight;
+	copy->maxSpeed = maxSpeed;
+	copy->minClearance = minClearance;
+	copy->sensedRadius = sensedRadius;
+	return copy;
+}
+
+/* update() replans at the start of every segment and otherwise keeps flying the
+ * current plan. */
+uint32_t Autopilot::update(const Simulation& sim) {
+	if (sim.state != INGAME) {
+		return 0;
+	}
+	if (best.size() != numSegments) {
+		begin(sim);
+	}
+
+	// A new target (after landing on the old one) makes the plan so far useless
+	if (sim.getNearestArea() != target) {
+		best.assign(numSegments, 0);
+		tickInSegment = 0;
+	}
+	else if (tickInSegment == 0) {
+		// Move on to the next segment of the last plan, then improve on it
+		rotate(best.begin(), best.begin() + 1, best.end());
+		best.back() = best[numSegments - 2];
+	}
+	if (tickInSegment == 0) {
+		plan(sim);
+	}
+
+	uint32_t input = best[0];
+	tickInSegment = (tickInSegment + 1) % segmentTicks;
+	return input;
+}
+
+/* makeCandidates() fills the batch: the last best plan, a few steady inputs, and
+ * the rest random mutations of the best plan. */
+void Autopilot::makeCandidates() {
+	for (int c = 0; c < numCandidates; c++) {
+		uint32_t* inputs = &candidates[c * numSegments];
+		for (int s = 0; s < numSegments; s++) {
+			if (c == 0) {
+				inputs[s] = best[s];
+			}
+			else if (c <= 15) {
+				inputs[s] = verticalInputs[(c - 1) % 3] | horizontalInputs[(c - 1) / 3];
+			}
+			else {
+				inputs[s] = random.range(0, 1) < 0.25f ? randomInput(random) : best[s];
+			}
+		}
+	}
+}
+
+/* plan() snapshots the game and scores the candidates on the rollout simulations,
+ * a batch per thread at a time, until all are scored or the budget runs out. */
+void Autopilot::plan(const Simulation& sim) {
+	ProfileScope scope("autopilot");
+
+	target = sim.getNearestArea();
+	if (target < 0) {
+		best.assign(numSegments, 0);
+		return;
+	}
+
+	uint64_t startTime = ofGetElapsedTimeMicros();
+
+	sim.save(start);
+	bStartGrounded = sim.collisionBoxes.size() >= 10;
+	senseGround(sim);
+	makeCandidates();
+
+	// One rollout simulation for every thread that can work on the plan, the
+	// calling one included
+	int numRollouts = jobs != NULL ? jobs->getNumThreads() + 1 : 1;
+	while (rollouts.size() < numRollouts) {
+		rollouts.push_back(unique_ptr<Simulation>(new Simulation()));
+		rollouts.back()->bEffects = false;
+	}
+	for (int i = 0; i < numRollouts; i++) {
+		rollouts[i]->copySettings(sim);
+	}
+
+	// Candidates are handed out one at a time; the budget is checked before each
+	atomic<int> next(0);
+	auto worker = [&](int begin, int end) {
+		for (int r = begin; r < end; r++) {
+			for (int c = next++; c < numCandidates; c = next++) {
+				if (c > 0 && ofGetElapsedTimeMicros() - startTime > budgetMicros) {
+					costs[c] = FLT_MAX;
+					continue;
+				}
+				evaluate(*rollouts[r], c);
+			}
+		}
+	};
+	if (jobs != NULL) {
+		jobs->parallelFor("autopilot rollouts", numRollouts, 1, worker);
+	}
+	else {
+		worker(0, numRollouts);
+	}
+
+	int bestCandidate = 0;
+	numEvaluated = 0;
+	for (int c = 0; c < numCandidates; c++) {
+		if (costs[c] == FLT_MAX) continue;
+		numEvaluated++;
+		if (costs[c] < costs[bestCandidate]) bestCandidate = c;
+	}
+	bestCost = costs[bestCandidate];
+	copy(candidates.begin() + bestCandidate * numSegments,
+		candidates.begin() + (bestCandidate + 1) * numSegments, best.begin());
+}
+
+// Score one candidate from the snapshot
+void Autopilot::evaluate(Simulation& rollout, int candidate) {
+	rollout.restore(start);
+
+	// The turbulence to come is not known, so every rollout draws its own
+	rollout.rng.setSeed(start.rng.state + candidate);
+
+	costs[candidate] = rolloutCost(rollout, &candidates[candidate * numSegments]);
+}
+
+/* rolloutCost() flies a plan and scores it. Touching down ends the rollout: a
+ * landing on the target is rewarded, the softer and sooner the better, a crash or touching
+ * down anywhere else is penalized. Otherwise the score is how far the lander is
+ * from flying the ideal approach to the target at the end, plus the fuel used. */
+float Autopilot::rolloutCost(Simulation& rollout, const uint32_t* inputs) {
+	const ofVec3f& area = rollout.landingAreas[target];
+	float startFuel = rollout.fuel;
+	int totalTicks = numSegments * segmentTicks;
+	float cost = 0;
+
+	for (int s = 0; s < numSegments; s++) {
+		for (int t = 0; t < segmentTicks; t++) {
+			rollout.step(inputs[s]);
+			int tick = s * segmentTicks + t;
+
+			if (rollout.shipExploded) {
+				return cost + 10000;
+			}
+			if (rollout.areaLanded[target]) {
+				return cost - 1000 - (totalTicks - tick) + 200 * rollout.impactSpeed + fuelWeight * (startFuel - rollout.fuel);
+			}
+			if (rollout.state != INGAME) {
+				return cost + 5000;
+			}
+			// Lifting off from an area just landed on touches the ground for a while
+			if ((rollout.events & EVENT_TOUCHDOWN) && !(bStartGrounded && tick < 30)) {
+				ofVec3f d = area - rollout.lander.position;
+				return cost + 500 + 10 * sqrtf(d.x * d.x + d.z * d.z);
+			}
+		}
+
+		// Keep clear of the terrain on the way
+		ofVec3f d = area - rollout.lander.position;
+		float horizontal = sqrtf(d.x * d.x + d.z * d.z);
+		float clearance = getClearance(rollout);
+		if (horizontal > 4 && clearance < minClearance) {
+			cost += (minClearance - clearance) * 20;
+		}
+	}
+
+	// Ideal velocity: head for the target at a speed that eases off when close,
+	// at cruise height until overhead, then descend more slowly the lower it gets
+	const ofVec3f& p = rollout.lander.position;
+	ofVec3f d = area - p;
+	float horizontal = sqrtf(d.x * d.x + d.z * d.z);
+	float height = p.y - area.y;
+
+	ofVec3f desired(0, 0, 0);
+	if (horizontal > 0.01f) {
+		float speed = min(horizontal * 0.4f, maxSpeed);
+		desired.x = d.x / horizontal * speed;
+		desired.z = d.z / horizontal * speed;
+	}
+	if (horizontal > 3) {
+		desired.y = ofClamp((planCruiseHeight - height) * 0.5f, -3, 3);
+	}
+	else {
+		desired.y = -ofClamp(0.4f + height * 0.3f, 0.4f, 2.5f);
+	}
+
+	cost += 2 * horizontal;
+	cost += 4 * (rollout.lander.velocity - desired).length();
+	cost += fuelWeight * (startFuel - rollout.fuel);
+	return cost;
+}
+
+/* senseGround() collects where the rays of the last sensor scan met the ground,
+ * if that scan was of this tick, and raises the cruise height for this plan over
+ * the ground seen near the straight line to the target. */
+void Autopilot::senseGround(const Simulation& sim) {
+	sensedGround.clear();
+	planCruiseHeight = cruiseHeight;
+	if (sensors == NULL || sensors->scannedTick != sim.tick) return;
+
+	for (int i = 0; i < sensors->rays.size(); i++) {
+		ofVec3f point;
+		if (sensors->getHitPoint(i, point)) sensedGround.push_back(point);
+	}
+
+	const ofVec3f& p = sim.lander.position;
+	const ofVec3f& area = sim.landingAreas[target];
+	float ax = area.x - p.x;
+	float az = area.z - p.z;
+	float length2 = ax * ax + az * az;
+	for (int i = 0; i < sensedGround.size(); i++) {
+		const ofVec3f& g = sensedGround[i];
+		float t = length2 > 0 ? ofClamp(((g.x - p.x) * ax + (g.z - p.z) * az) / length2, 0, 1) : 0;
+		float dx = g.x - (p.x + ax * t);
+		float dz = g.z - (p.z + az * t);
+		if (dx * dx + dz * dz < sensedRadius * sensedRadius) {
+			planCruiseHeight = max(planCruiseHeight, g.y - area.y + minClearance);
+		}
+	}
+}
+
+// Height of a rollout's lander above the highest sensed ground within sensedRadius,
+// or above the heightfield where the sensors saw nothing
+float Autopilot::getClearance(const Simulation& rollout) const {
+	const ofVec3f& p = rollout.lander.position;
+	float ground = -FLT_MAX;
+	for (int i = 0; i < sensedGround.size(); i++) {
+		float dx = sensedGround[i].x - p.x;
+		float dz = sensedGround[i].z - p.z;
+		if (dx * dx + dz * dz < sensedRadius * sensedRadius) {
+			ground = max(ground, sensedGround[i].y);
+		}
+	}
+	if (ground == -FLT_MAX) return rollout.getAGL();
+	return p.y - ground;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Controller.h"
+
+class SensorSuite;
+
+/*
+ * Autopilot flies to the nearest landing area that has not been landed on yet,
+ * using as little fuel as it can. It is a sampling planner: every few ticks it
+ * snapshots the game, rolls out a batch of candidate input sequences on private
+ * copies of the simulation (in parallel on the job system, against the real terrain), scores where
+ * each one ends up and keeps the best. Planning stops early once budgetMicros is
+ * spent, so the cost per frame stays bounded.
+ *
+ * A plan is numSegments inputs, each held for segmentTicks ticks. The best plan is
+ * kept and shifted along between replans, so each search starts from the last one.
+ *
+ * With a sensor suite scanned this tick, the ground its rays met stands in for
+ * the heightfield when judging terrain clearance, and ground the lidar sees on
+ * the way to the target raises the cruise height to clear it.
+ */
+class Autopilot : public Controller {
+public:
+	int numSegments = 12;
+	int segmentTicks = 10;
+	int numCandidates = 96;
+	JobSystem* jobs = NULL; // optional, to roll the candidates out in parallel
+	const SensorSuite* sensors = NULL; // optional, read for terrain clearance
+	float budgetMicros = 3000;
+
+	// Cost weights
+	float fuelWeight = 2.0f;
+	float cruiseHeight = 8.0f; // height above the target to travel at
+	float maxSpeed = 5.0f;
+	float minClearance = 2.0f;   // height above the ground to keep on the way
+	float sensedRadius = 3.0f;   // horizontal reach of a sensed ground point
+
+	void begin(const Simulation& sim);
+	uint32_t update(const Simulation& sim);
+	Controller* clone() const;
+
+	int getTarget() const { return target; }
+	float getBestCost() const { return bestCost; }
+	int getNumEvaluated() const { return numEvaluated; }
+
+private:
+	void plan(const Simulation& sim);
+	void makeCandidates();
+	void evaluate(Simulation& rollout, int candidate);
+	float rolloutCost(Simulation& rollout, const uint32_t* inputs);
+	void senseGround(const Simulation& sim);
+	float getClearance(const Simulation& rollout) const;
+
+	vector<uint32_t> best;       // numSegments inputs
+	vector<uint32_t> candidates; // numCandidates * numSegments inputs
+	vector<float> costs;
+	int tickInSegment = 0;
+	int target = -1;
+	float bestCost = 0;
+	int numEvaluated = 0;
+	bool bStartGrounded = false;
+
+	SimRandom random;
+	SimSnapshot start;
+	vector<ofVec3f> sensedGround; // where the sensor rays met the ground at the start of the plan
+	float planCruiseHeight = 0;
+	vector<unique_ptr<Simulation>> rollouts; // one per thread of the job system
+};
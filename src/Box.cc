@@ -13,12 +13,71 @@
  */
 
 bool Box::intersect(const Ray& r, float t0, float t1) const {
+    float t;
+    return intersect(r, t0, t1, t);
+}
+
+/* With SSE the three slabs are clipped at once: the distances to both planes of
+ * every slab come out of one subtract and multiply, and the near and far ends of
+ * the ray inside the box are the largest near and smallest far distance. This is
+ * the same test as the branchy version below, without its early outs.
+ *
+ * Where the direction has a zero component and the origin lies on one of that
+ * slab's planes, the distance is 0 * inf = NaN. The ray then runs along a face
+ * of the box, which counts as inside the slab, like a point on a face counts as
+ * inside() the box. */
+bool Box::intersect(const Ray& r, float t0, float t1, float& tRtn) const {
+    // A ray along an axis has only one slab to clip; the other two just have to
+    // hold its origin, which rules out most boxes with a few compares
+    if (r.axis >= 0) {
+        int a = r.axis;
+        int b = (a == 0) ? 1 : 0;
+        int c = (a == 2) ? 1 : 2;
+        const Vector3& o = r.origin;
+        if (o[b] < parameters[0][b] || o[b] > parameters[1][b] ||
+            o[c] < parameters[0][c] || o[c] > parameters[1][c])
+            return false;
+        float tmin = (parameters[r.sign[a]][a] - o[a]) * r.inv_direction[a];
+        float tmax = (parameters[1 - r.sign[a]][a] - o[a]) * r.inv_direction[a];
+        tRtn = tmin;
+        return ((tmin < t1) && (tmax > t0));
+    }
+
+#ifdef VECTOR3_SSE
+    __m128 origin = r.origin.simd();
+    __m128 inv = r.inv_direction.simd();
+    __m128 ta = _mm_mul_ps(_mm_sub_ps(parameters[0].simd(), origin), inv);
+    __m128 tb = _mm_mul_ps(_mm_sub_ps(parameters[1].simd(), origin), inv);
+    __m128 tnear = _mm_min_ps(ta, tb);
+    __m128 tfar = _mm_max_ps(ta, tb);
+    __m128 onPlane = _mm_cmpunord_ps(ta, tb);
+    tnear = _mm_or_ps(_mm_andnot_ps(onPlane, tnear), _mm_and_ps(onPlane, _mm_set1_ps(-INFINITY)));
+    tfar = _mm_or_ps(_mm_andnot_ps(onPlane, tfar), _mm_and_ps(onPlane, _mm_set1_ps(INFINITY)));
+
+    // Reduce over x, y and z only, leaving out the padding lane
+    __m128 tmin = _mm_max_ss(_mm_max_ss(tnear, _mm_shuffle_ps(tnear, tnear, _MM_SHUFFLE(1, 1, 1, 1))),
+        _mm_shuffle_ps(tnear, tnear, _MM_SHUFFLE(2, 2, 2, 2)));
+    __m128 tmax = _mm_min_ss(_mm_min_ss(tfar, _mm_shuffle_ps(tfar, tfar, _MM_SHUFFLE(1, 1, 1, 1))),
+        _mm_shuffle_ps(tfar, tfar, _MM_SHUFFLE(2, 2, 2, 2)));
+    float tminf = _mm_cvtss_f32(tmin);
+    float tmaxf = _mm_cvtss_f32(tmax);
+    tRtn = tminf;
+    return tminf <= tmaxf && tminf < t1 && tmaxf > t0;
+#else
     float tmin, tmax, tymin, tymax, tzmin, tzmax;
 
     tmin = (parameters[r.sign[0]].x() - r.origin.x()) * r.inv_direction.x();
     tmax = (parameters[1 - r.sign[0]].x() - r.origin.x()) * r.inv_direction.x();
     tymin = (parameters[r.sign[1]].y() - r.origin.y()) * r.inv_direction.y();
     tymax = (parameters[1 - r.sign[1]].y() - r.origin.y()) * r.inv_direction.y();
+    if (isnan(tmin) || isnan(tmax)) {
+        tmin = -INFINITY;
+        tmax = INFINITY;
+    }
+    if (isnan(tymin) || isnan(tymax)) {
+        tymin = -INFINITY;
+        tymax = INFINITY;
+    }
     if ((tmin > tymax) || (tymin > tmax))
         return false;
     if (tymin > tmin)
@@ -27,11 +86,17 @@ bool Box::intersect(const Ray& r, float t0, float t1) const {
         tmax = tymax;
     tzmin = (parameters[r.sign[2]].z() - r.origin.z()) * r.inv_direction.z();
     tzmax = (parameters[1 - r.sign[2]].z() - r.origin.z()) * r.inv_direction.z();
+    if (isnan(tzmin) || isnan(tzmax)) {
+        tzmin = -INFINITY;
+        tzmax = INFINITY;
+    }
     if ((tmin > tzmax) || (tzmin > tmax))
         return false;
     if (tzmin > tmin)
         tmin = tzmin;
     if (tzmax < tmax)
         tmax = tzmax;
+    tRtn = tmin;
     return ((tmin < t1) && (tmax > t0));
+#endif
 }
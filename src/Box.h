@@ -25,16 +25,19 @@ public:
 	}
 	// (t0, t1) is the interval for valid hits
 	bool intersect(const Ray&, float t0, float t1) const;
+	// Same test, also returning the ray parameter where the ray enters the box
+	bool intersect(const Ray&, float t0, float t1, float& tRtn) const;
 
 	// corners
 	Vector3 parameters[2];
 
-	Vector3 min() { return parameters[0]; }
-	Vector3 max() { return parameters[1]; }
-	const bool inside(const Vector3& p) {
-		return ((p.x() >= parameters[0].x() && p.x() <= parameters[1].x()) &&
-			(p.y() >= parameters[0].y() && p.y() <= parameters[1].y()) &&
-			(p.z() >= parameters[0].z() && p.z() <= parameters[1].z()));
+	Vector3 min() const { return parameters[0]; }
+	Vector3 max() const { return parameters[1]; }
+	bool inside(const Vector3& p) const {
+		return parameters[0] <= p && p <= parameters[1];
+	}
+	bool inside(float x, float y, float z) const {
+		return inside(Vector3(x, y, z));
 	}
 	const bool inside(Vector3* points, int size) {
 		bool allInside = true;
@@ -45,16 +48,17 @@ public:
 		return allInside;
 	}
 
-	// overlap() checks if two boxes overlap
-	bool overlap(const Box& box) {
-		bool isXinRange = max().x() >= box.parameters[0].x() && min().x() <= box.parameters[1].x();
-		bool isYinRange = max().y() >= box.parameters[0].y() && min().y() <= box.parameters[1].y();
-		bool isZinRange = max().z() >= box.parameters[0].z() && min().z() <= box.parameters[1].z();
+	// contains() checks if the given box lies entirely within this box
+	bool contains(const Box& box) const {
+		return parameters[0] <= box.parameters[0] && box.parameters[1] <= parameters[1];
+	}
 
-		return isXinRange && isYinRange && isZinRange;
+	// overlap() checks if two boxes overlap
+	bool overlap(const Box& box) const {
+		return box.parameters[0] <= parameters[1] && parameters[0] <= box.parameters[1];
 	}
 
-	Vector3 center() {
+	Vector3 center() const {
 		return ((max() - min()) / 2 + min());
 	}
 };
@@ -0,0 +1,30 @@
+#include "Controller.h"
+
+uint32_t DescentController::update(const Simulation& sim) {
+	float targetSpeed = ofClamp(sim.getAGL() * slowdownRate, touchdownSpeed, maxDescentSpeed);
+	return sim.lander.velocity.y < -targetSpeed ? INPUT_THRUST_UP : 0;
+}
+
+bool ScriptedController::load(const string& path) {
+	FlightPlayer player;
+	if (!player.load(path)) return false;
+	header = player.header;
+	runs = player.runs;
+	return true;
+}
+
+void ScriptedController::begin(const Simulation&) {
+	run = 0;
+	tickInRun = 0;
+}
+
+uint32_t ScriptedController::update(const Simulation&) {
+	if (run >= runs.size()) return 0;
+
+	uint32_t input = runs[run].input;
+	if (++tickInRun >= runs[run].ticks) {
+		run++;
+		tickInRun = 0;
+	}
+	return input;
+}
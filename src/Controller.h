@@ -0,0 +1,41 @@
+#pragma once
+
+#include "Simulation.h"
+#include "FlightRecorder.h"
+
+// Controller flies the lander in place of the keyboard, returning the input bits
+// for the next tick. Batch tools run one controller per simulation and make the
+// copies they need with clone().
+class Controller {
+public:
+	virtual ~Controller() {}
+	virtual void begin(const Simulation&) {}
+	virtual uint32_t update(const Simulation& sim) = 0;
+	virtual Controller* clone() const = 0;
+};
+
+// DescentController comes straight down, slowing to touchdownSpeed near the ground
+class DescentController : public Controller {
+public:
+	float touchdownSpeed = 0.5f;
+	float maxDescentSpeed = 4.0f;
+	float slowdownRate = 0.3f; // descent speed per unit of altitude
+
+	uint32_t update(const Simulation& sim);
+	Controller* clone() const { return new DescentController(*this); }
+};
+
+// ScriptedController plays back the input of a recorded flight, wherever it starts
+class ScriptedController : public Controller {
+private:
+	size_t run = 0;
+	uint32_t tickInRun = 0;
+public:
+	FlightHeader header;
+	vector<InputRun> runs;
+
+	bool load(const string& path);
+	void begin(const Simulation&);
+	uint32_t update(const Simulation& sim);
+	Controller* clone() const { return new ScriptedController(*this); }
+};
@@ -0,0 +1,150 @@
+#include "FlightRecorder.h"
+#include "Util.h"
+#include <cstring>
+#include <fstream>
+
+/* begin() starts a new recording from the state the simulation is in right before
+ * start(seed) is called on it, over the terrain with the given hashMesh(). */
+void FlightRecorder::begin(const Simulation& sim, uint64_t seed, const string& terrainPath, uint64_t terrainHash) {
+	clear();
+
+	memcpy(header.magic, "LLRC", 4);
+	header.version = 2;
+	header.seed = seed;
+	header.dt = sim.dt;
+	header.startPosition[0] = sim.lander.position.x;
+	header.startPosition[1] = sim.lander.position.y;
+	header.startPosition[2] = sim.lander.position.z;
+	header.startRotation = sim.lander.rotation;
+	for (int k = 0; k < 3; k++) {
+		header.landerMin[k] = sim.lander.sceneMin[k];
+		header.landerMax[k] = sim.lander.sceneMax[k];
+	}
+	for (int i = 0; i < 3; i++) {
+		header.landingAreas[i][0] = sim.landingAreas[i].x;
+		header.landingAreas[i][1] = sim.landingAreas[i].y;
+		header.landingAreas[i][2] = sim.landingAreas[i].z;
+	}
+	strncpy(header.terrainPath, terrainPath.c_str(), sizeof(header.terrainPath) - 1);
+	header.terrainHash = terrainHash;
+
+	bRecording = true;
+}
+
+// Append the input of one tick
+void FlightRecorder::record(uint32_t input) {
+	if (!bRecording) return;
+
+	if (runs.size() > 0 && runs.back().input == input) {
+		runs.back().ticks++;
+	}
+	else {
+		InputRun r;
+		r.ticks = 1;
+		r.input = input;
+		runs.push_back(r);
+	}
+	header.numTicks++;
+}
+
+// Write the recording to disk and stop recording
+bool FlightRecorder::save(const string& path) {
+	bRecording = false;
+	header.numRuns = (uint32_t)runs.size();
+
+	ofstream out(path, ios::binary);
+	out.write((const char*)&header, sizeof(header));
+	out.write((const char*)runs.data(), runs.size() * sizeof(InputRun));
+	if (!out) {
+		cout << "Error: Can't write flight recording " << path << endl;
+		return false;
+	}
+	return true;
+}
+
+/* rewind() drops everything recorded after the first numTicks ticks and records
+ * on from there, so a flight that was rewound is saved the way it was flown. */
+void FlightRecorder::rewind(uint32_t numTicks) {
+	if (memcmp(header.magic, "LLRC", 4) != 0 || numTicks > header.numTicks) return;
+
+	uint32_t ticks = 0;
+	size_t n = 0;
+	while (n < runs.size() && ticks + runs[n].ticks <= numTicks) {
+		ticks += runs[n].ticks;
+		n++;
+	}
+	if (ticks < numTicks) {
+		runs[n].ticks = numTicks - ticks;
+		n++;
+	}
+	runs.resize(n);
+	header.numTicks = numTicks;
+	bRecording = true;
+}
+
+void FlightRecorder::clear() {
+	memset(&header, 0, sizeof(header));
+	runs.clear();
+	bRecording = false;
+}
+
+bool FlightPlayer::load(const string& path) {
+	ifstream in(path, ios::binary);
+	if (!in.read((char*)&header, sizeof(header)) || memcmp(header.magic, "LLRC", 4) != 0) {
+		cout << "Error: " << path << " is not a flight recording" << endl;
+		return false;
+	}
+	if (header.version != 2) {
+		cout << "Error: " << path << " was recorded without its terrain's hash and can't be replayed exactly" << endl;
+		return false;
+	}
+
+	runs.resize(header.numRuns);
+	if (!in.read((char*)runs.data(), runs.size() * sizeof(InputRun))) {
+		cout << "Error: Flight recording " << path << " is truncated" << endl;
+		return false;
+	}
+	run = 0;
+	tickInRun = 0;
+	return true;
+}
+
+/* checkTerrain() tells whether the flight was recorded on this very terrain. On any
+ * other, even a re-export of the same model, the replay would not be exact. */
+bool FlightPlayer::checkTerrain(const ofMesh& terrain) const {
+	if (hashMesh(terrain) != header.terrainHash) {
+		cout << "Error: The flight was recorded on a different version of " << header.terrainPath
+			<< " than the one loaded, so it can't be replayed exactly" << endl;
+		return false;
+	}
+	return true;
+}
+
+/* begin() puts the simulation into the state the recording started from. */
+void FlightPlayer::begin(Simulation& sim) {
+	sim.dt = header.dt;
+	for (int i = 0; i < 3; i++) {
+		sim.landingAreas[i] = ofVec3f(header.landingAreas[i][0], header.landingAreas[i][1], header.landingAreas[i][2]);
+	}
+	sim.landerMin = ofVec3f(header.landerMin[0], header.landerMin[1], header.landerMin[2]);
+	sim.landerMax = ofVec3f(header.landerMax[0], header.landerMax[1], header.landerMax[2]);
+	sim.reset(header.seed);
+	sim.lander.setPosition(ofVec3f(header.startPosition[0], header.startPosition[1], header.startPosition[2]));
+	sim.lander.setRotationAngle(header.startRotation);
+	sim.start(header.seed);
+
+	run = 0;
+	tickInRun = 0;
+}
+
+// Advance the simulation by one recorded tick. Returns false once the recording is over.
+bool FlightPlayer::step(Simulation& sim) {
+	if (isDone()) return false;
+
+	sim.step(runs[run].input);
+	if (++tickInRun >= runs[run].ticks) {
+		run++;
+		tickInRun = 0;
+	}
+	return true;
+}
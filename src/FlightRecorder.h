@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Simulation.h"
+
+/*
+ * Recorded flight format (.llrec). A flight is fully determined by where it started,
+ * the seed, the terrain and the input of every tick, so that is all that is stored:
+ *
+ *      FlightHeader
+ *      numRuns * InputRun   run-length encoded input, in tick order
+ */
+struct FlightHeader {
+	char magic[4];              // "LLRC"
+	uint32_t version;
+	uint64_t seed;
+	float dt;
+	float startPosition[3];
+	float startRotation;
+	float landerMin[3];         // lander model bounds
+	float landerMax[3];
+	float landingAreas[3][3];
+	char terrainPath[128];      // terrain file the flight was recorded on, relative to the data folder
+	uint64_t terrainHash;       // hashMesh() of the terrain, which a replay has to match
+	uint32_t numTicks;
+	uint32_t numRuns;
+};
+
+struct InputRun {
+	uint32_t ticks;
+	uint32_t input;
+};
+
+// FlightRecorder collects the input of a flight tick by tick and writes it out
+class FlightRecorder {
+public:
+	void begin(const Simulation& sim, uint64_t seed, const string& terrainPath, uint64_t terrainHash);
+	void record(uint32_t input);
+	bool save(const string& path);
+	void rewind(uint32_t numTicks);
+	void clear();
+	bool isRecording() const { return bRecording; }
+
+	FlightHeader header;
+	vector<InputRun> runs;
+
+private:
+	bool bRecording = false;
+};
+
+// FlightPlayer feeds a recorded flight back into a simulation
+class FlightPlayer {
+public:
+	bool load(const string& path);
+	bool checkTerrain(const ofMesh& terrain) const;
+	void begin(Simulation& sim);
+	bool step(Simulation& sim);
+	bool isDone() const { return run >= runs.size(); }
+
+	FlightHeader header;
+	vector<InputRun> runs;
+
+private:
+	size_t run = 0;
+	uint32_t tickInRun = 0;
+};
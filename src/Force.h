@@ -1,60 +1,113 @@
 #pragma once
 #include "ofMain.h"
 #include "PhysicsObject.h"
+#include "SimRandom.h"
 
-class Force {
+/*
+ * Forces are plain values with an inline apply() that adds the force to one
+ * object. They have no common virtual base: the lander calls them directly, and
+ * particle systems apply a fixed set of them through applyForces(), which the
+ * compiler turns into one loop with every apply() inlined.
+ */
+
+// Defaults for the hooks applyForces() calls on every force
+class ForceBase {
 public:
-	virtual void update(PhysicsObject*) = 0;
-	bool applyOnce = false;
-	bool applied = false;
+	bool isActive() const { return true; } // whether to apply it on this pass
+	void endPass() {}                      // called once a pass over the particles is done
 };
 
 // ThrustForce is a force used for linear motion
-class ThrustForce : public Force {
+class ThrustForce : public ForceBase {
 private:
 	ofVec3f thrust;
 public:
 	ThrustForce(const ofVec3f& thrust);
-	ofVec3f getThrust();
+	ofVec3f getThrust() const;
 	void setThrust(const ofVec3f&);
-	void update(PhysicsObject*);
+	void apply(PhysicsObject& obj) const { obj.forces += thrust; }
 };
 
 // TangentialForce is a force used for rotational motion
-class TangentialForce : public Force {
+class TangentialForce : public ForceBase {
 private:
 	ofVec3f torque;
 public:
 	TangentialForce(const ofVec3f& torque);
-	ofVec3f getTorque();
+	ofVec3f getTorque() const;
 	void setTorque(const ofVec3f& torque);
-	void update(PhysicsObject*);
+	void apply(PhysicsObject& obj) const {
+		// Torque Formula
+		// t = F * r
+		obj.tangentialForces += torque / (obj.radius);
+	}
 };
 
-class TurbulenceForce : public Force {
+class TurbulenceForce : public ForceBase {
 private:
 	ofVec3f tmin, tmax;
+	SimRandom* rng;
 public:
-	TurbulenceForce(const ofVec3f& tmin, const ofVec3f& tmax);
+	TurbulenceForce(const ofVec3f& tmin, const ofVec3f& tmax, SimRandom* rng);
 	void setTurbulence(const ofVec3f& tmin, const ofVec3f& tmax);
-	void update(PhysicsObject*);
+	void apply(PhysicsObject& obj) const {
+		obj.forces += ofVec3f(
+			rng->range(tmin.x, tmax.x),
+			rng->range(tmin.y, tmax.y),
+			rng->range(tmin.z, tmax.z)
+		);
+	}
 };
 
-class GravityForce : public Force {
+class GravityForce : public ForceBase {
 private:
 	float gravity;
 public:
 	GravityForce(float gravity);
 	void setGravity(float gravity);
-	void update(PhysicsObject*);
+	void apply(PhysicsObject& obj) const {
+		float gForce = obj.mass * -gravity;
+
+		obj.forces += ofVec3f(0, gForce, 0);
+	}
 };
 
-class ImpulseRadialForce : public Force {
+// ImpulseRadialForce kicks the particles present on the first pass after it is
+// armed in random directions, then stays off until it is armed again
+class ImpulseRadialForce : public ForceBase {
 private:
 	float magnitude;
-
+	SimRandom* rng;
 public:
-	ImpulseRadialForce(float magnitude);
+	ImpulseRadialForce(float magnitude, SimRandom* rng);
 	void setMagnitude(float magnitude);
-	void update(PhysicsObject*);
-};
\ No newline at end of file
+	void apply(PhysicsObject& obj) const {
+		ofVec3f dir = ofVec3f(
+			rng->range(-1, 1), rng->range(-1, 1), rng->range(-1, 1)
+		);
+		obj.forces += dir.normalize() * (magnitude * rng->range(0.8f, 1.0f));
+	}
+
+	bool applied = false;
+	void arm() { applied = false; }
+	bool isActive() const { return !applied; }
+	void endPass() { applied = true; }
+};
+
+/* applyForces() adds every force to each of count objects, in one pass over them.
+ * The forces are taken by value, so the loop works on copies in registers rather
+ * than reaching through pointers, and each object gets them in the order given.
+ * The forces' own state is the caller's to update, through endPass(). */
+template <typename T, typename... Forces>
+void applyForces(T* objects, int count, Forces... forces) {
+	bool active[] = { forces.isActive()... };
+	bool bAny = false;
+	for (bool a : active) bAny = bAny || a;
+	if (!bAny) return;
+
+	for (int i = 0; i < count; i++) {
+		int k = 0;
+		int expand[] = { 0, (active[k++] ? forces.apply(objects[i]) : void(), 0)... };
+		(void)expand;
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "ofMain.h"
+#include "box.h"
+
+/*
+ * View frustum as six planes extracted from a view-projection matrix, as described in:
+ *
+ *      Gil Gribb and Klaus Hartmann
+ *      "Fast Extraction of Viewing Frustum Planes from the World-View-Projection Matrix"
+ *      2001
+ *
+ */
+
+class Frustum {
+public:
+	Frustum() { }
+	Frustum(const glm::mat4& m) {
+		// glm matrices are column major, so row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+		for (int i = 0; i < 3; i++) {
+			for (int j = 0; j < 4; j++) {
+				planes[2 * i][j] = m[j][3] + m[j][i];
+				planes[2 * i + 1][j] = m[j][3] - m[j][i];
+			}
+		}
+	}
+
+	// Conservative test: false only if the box is entirely outside one of the planes
+	bool intersect(const Box& box) const {
+		for (int i = 0; i < 6; i++) {
+			const glm::vec4& p = planes[i];
+
+			// the box corner furthest along the plane normal
+			float x = p.x >= 0 ? box.parameters[1].x() : box.parameters[0].x();
+			float y = p.y >= 0 ? box.parameters[1].y() : box.parameters[0].y();
+			float z = p.z >= 0 ? box.parameters[1].z() : box.parameters[0].z();
+
+			if (p.x * x + p.y * y + p.z * z + p.w < 0) return false;
+		}
+		return true;
+	}
+
+	// left, right, bottom, top, near, far; (a, b, c, d) with ax + by + cz + d >= 0 inside
+	glm::vec4 planes[6];
+};
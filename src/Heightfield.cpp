@@ -0,0 +1,95 @@
+#include "Heightfield.h"
+
+/* create() rasterizes the points stored in the octree's leaf nodes into a grid,
+ * keeping the highest point that falls into each cell. */
+void Heightfield::create(const Octree& octree, float size) {
+	Box bounds = octree.root.box;
+	cellSize = size;
+	originX = bounds.min().x();
+	originZ = bounds.min().z();
+	numX = (int)ceil((bounds.max().x() - originX) / cellSize) + 1;
+	numZ = (int)ceil((bounds.max().z() - originZ) / cellSize) + 1;
+
+	heights.assign(numX * numZ, -FLT_MAX);
+	addLeafPoints(octree, octree.root);
+	fillHoles();
+}
+
+void Heightfield::addLeafPoints(const Octree& octree, const TreeNode& node) {
+	if (node.children.size() > 0) {
+		for (int i = 0; i < node.children.size(); i++) {
+			addLeafPoints(octree, node.children[i]);
+		}
+		return;
+	}
+
+	for (int i = 0; i < node.points.size(); i++) {
+		const glm::vec3& v = octree.getVertex(node.points[i]);
+		int cx = ofClamp((int)((v.x - originX) / cellSize), 0, numX - 1);
+		int cz = ofClamp((int)((v.z - originZ) / cellSize), 0, numZ - 1);
+		float& h = heights[cz * numX + cx];
+		if (v.y > h) h = v.y;
+	}
+}
+
+/* fillHoles() grows the sampled cells into cells that received no vertex, which
+ * happens wherever the grid is finer than the terrain mesh. */
+void Heightfield::fillHoles() {
+	bool changed = true;
+	while (changed) {
+		changed = false;
+		vector<float> filled = heights;
+		for (int z = 0; z < numZ; z++) {
+			for (int x = 0; x < numX; x++) {
+				if (heights[z * numX + x] != -FLT_MAX) continue;
+
+				float h = -FLT_MAX;
+				if (x > 0) h = max(h, heights[z * numX + x - 1]);
+				if (x < numX - 1) h = max(h, heights[z * numX + x + 1]);
+				if (z > 0) h = max(h, heights[(z - 1) * numX + x]);
+				if (z < numZ - 1) h = max(h, heights[(z + 1) * numX + x]);
+
+				if (h != -FLT_MAX) {
+					filled[z * numX + x] = h;
+					changed = true;
+				}
+			}
+		}
+		heights.swap(filled);
+	}
+}
+
+/* heightAt() bilinearly interpolates the terrain height at (x, z). Points outside
+ * the grid return -FLT_MAX so nothing collides there. */
+float Heightfield::heightAt(float x, float z) const {
+	float h;
+	heightsAt(&x, &z, 1, &h);
+	return h;
+}
+
+/* heightsAt() is the batched form of heightAt(). It takes the coordinates as
+ * separate arrays and runs a branch-light loop over them, so callers can query
+ * a whole particle system in one pass. */
+void Heightfield::heightsAt(const float* x, const float* z, int count, float* heightsRtn) const {
+	const float invCell = 1.0f / cellSize;
+	const float* grid = heights.data();
+
+	for (int i = 0; i < count; i++) {
+		float gx = (x[i] - originX) * invCell;
+		float gz = (z[i] - originZ) * invCell;
+		int ix = (int)floorf(gx);
+		int iz = (int)floorf(gz);
+
+		if (ix < 0 || iz < 0 || ix >= numX - 1 || iz >= numZ - 1) {
+			heightsRtn[i] = -FLT_MAX;
+			continue;
+		}
+
+		float fx = gx - ix;
+		float fz = gz - iz;
+		const float* row = grid + iz * numX + ix;
+		float h0 = row[0] + (row[1] - row[0]) * fx;
+		float h1 = row[numX] + (row[numX + 1] - row[numX]) * fx;
+		heightsRtn[i] = h0 + (h1 - h0) * fz;
+	}
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "ofMain.h"
+#include "Octree.h"
+
+// Heightfield is a regular XZ grid of terrain heights sampled from the octree.
+// It answers "how high is the ground here" with a couple of array lookups, which
+// makes it cheap enough to test every particle against the terrain each frame.
+class Heightfield {
+public:
+	void create(const Octree& octree, float cellSize);
+	float heightAt(float x, float z) const;
+	void heightsAt(const float* x, const float* z, int count, float* heightsRtn) const;
+	bool isEmpty() const { return heights.size() == 0; }
+
+	float cellSize = 1.0f;
+	float originX = 0, originZ = 0;
+	int numX = 0, numZ = 0;
+	vector<float> heights;
+
+private:
+	void addLeafPoints(const Octree& octree, const TreeNode& node);
+	void fillHoles();
+};
@@ -0,0 +1,200 @@
+#include "JobSystem.h"
+#include "Profiler.h"
+
+// The pool a thread works for and its queue there
+static thread_local const JobSystem* currentSystem = NULL;
+static thread_local int currentIndex = 0;
+
+JobSystem::JobSystem() {
+	queues.push_back(make_unique<Queue>());
+}
+
+// Start numThreads workers. With none, everything runs on the calling thread.
+void JobSystem::start(int numThreads) {
+	stop();
+	bStop = false;
+	for (int i = 1; i <= numThreads; i++) {
+		queues.push_back(make_unique<Queue>());
+	}
+	for (int i = 1; i <= numThreads; i++) {
+		workers.push_back(thread(&JobSystem::threadedFunction, this, i));
+	}
+}
+
+void JobSystem::stop() {
+	{
+		lock_guard<mutex> lock(sleepMutex);
+		bStop = true;
+	}
+	sleepCondition.notify_all();
+	for (int i = 0; i < workers.size(); i++) {
+		workers[i].join();
+	}
+	workers.clear();
+	queues.resize(1);
+}
+
+int JobSystem::getThreadIndex() const {
+	return currentSystem == this ? currentIndex : 0;
+}
+
+// Queue a job that is ready to run on the calling thread's queue and wake a worker
+void JobSystem::push(Job* job) {
+	Queue& queue = *queues[getThreadIndex()];
+	{
+		lock_guard<mutex> lock(queue.queueMutex);
+		queue.jobs.push_back(job);
+	}
+	numQueued++;
+
+	// Taking the lock orders this with a worker about to go to sleep
+	{
+		lock_guard<mutex> lock(sleepMutex);
+	}
+	sleepCondition.notify_one();
+}
+
+/* pop() takes the newest job of the thread's own queue, which is the likeliest to
+ * still be in cache, or else steals the oldest job of another queue. */
+JobSystem::Job* JobSystem::pop(int index) {
+	int n = (int)queues.size();
+	for (int k = 0; k < n; k++) {
+		Queue& queue = *queues[(index + k) % n];
+		lock_guard<mutex> lock(queue.queueMutex);
+		if (queue.jobs.empty()) continue;
+
+		Job* job;
+		if (k == 0) {
+			job = queue.jobs.back();
+			queue.jobs.pop_back();
+		}
+		else {
+			job = queue.jobs.front();
+			queue.jobs.pop_front();
+		}
+		numQueued--;
+		return job;
+	}
+	return NULL;
+}
+
+// Run a job, then release the jobs that were waiting on it
+void JobSystem::execute(Job* job, int index) {
+	uint64_t start = ofGetElapsedTimeMicros();
+	job->work();
+	job->ms = (ofGetElapsedTimeMicros() - start) / 1000.0f;
+	job->thread = index;
+	if (bProfile && !job->name.empty()) {
+		Profiler::get().record("job " + job->name, job->ms);
+	}
+
+	for (int i = 0; i < job->dependents.size(); i++) {
+		if (job->dependents[i]->numWaiting.fetch_sub(1) == 1) {
+			push(job->dependents[i]);
+		}
+	}
+
+	// The job may be freed by its owner from here on
+	job->remaining->fetch_sub(1, memory_order_acq_rel);
+}
+
+// Run jobs, from any queue, until the given graph or loop has finished
+void JobSystem::workUntilDone(const atomic<int>& remaining) {
+	int index = getThreadIndex();
+	while (remaining.load(memory_order_acquire) > 0) {
+		Job* job = pop(index);
+		if (job != NULL) {
+			execute(job, index);
+		}
+		else {
+			this_thread::yield();
+		}
+	}
+}
+
+void JobSystem::threadedFunction(int index) {
+	currentSystem = this;
+	currentIndex = index;
+
+	while (true) {
+		Job* job = pop(index);
+		if (job != NULL) {
+			execute(job, index);
+			continue;
+		}
+
+		unique_lock<mutex> lock(sleepMutex);
+		sleepCondition.wait(lock, [this] { return bStop || numQueued > 0; });
+		if (bStop) return;
+	}
+}
+
+/* add() puts a job into the graph for the next run(). Dependencies are jobs added
+ * before it. The graph is built and run by one thread at a time. */
+JobId JobSystem::add(const string& name, function<void()> work, initializer_list<JobId> dependencies) {
+	graph.emplace_back();
+	Job& job = graph.back();
+	job.name = name;
+	job.work = work;
+	for (JobId d : dependencies) {
+		graph[d].dependents.push_back(&job);
+		job.numWaiting++;
+	}
+	return (JobId)graph.size() - 1;
+}
+
+// Run the graph added since the last run, returning once every job has finished
+void JobSystem::run() {
+	atomic<int> remaining((int)graph.size());
+
+	// Find the jobs free to start before starting any, since a finished job
+	// queues the dependents it releases itself
+	vector<Job*> ready;
+	for (int i = 0; i < graph.size(); i++) {
+		graph[i].remaining = &remaining;
+		if (graph[i].numWaiting == 0) {
+			ready.push_back(&graph[i]);
+		}
+	}
+	for (int i = 0; i < ready.size(); i++) {
+		push(ready[i]);
+	}
+	workUntilDone(remaining);
+
+	timings.clear();
+	for (int i = 0; i < graph.size(); i++) {
+		timings.push_back({ graph[i].name, graph[i].ms, graph[i].thread });
+	}
+	graph.clear();
+}
+
+/* parallelFor() calls body over [0, count) in chunks of grain, spread over the
+ * pool, and returns once all chunks are done. Loops of a single chunk run right
+ * away on the calling thread. */
+void JobSystem::parallelFor(const string& name, int count, int grain, function<void(int begin, int end)> body) {
+	if (count <= 0) return;
+	uint64_t start = ofGetElapsedTimeMicros();
+
+	int numChunks = (count + grain - 1) / grain;
+	if (numChunks == 1 || workers.empty()) {
+		body(0, count);
+	}
+	else {
+		atomic<int> remaining(numChunks);
+		vector<Job> chunks(numChunks);
+		for (int c = 0; c < numChunks; c++) {
+			int begin = c * grain;
+			int end = min(count, begin + grain);
+			chunks[c].work = [&body, begin, end] { body(begin, end); };
+			chunks[c].remaining = &remaining;
+		}
+		for (int c = 0; c < numChunks; c++) {
+			push(&chunks[c]);
+		}
+		workUntilDone(remaining);
+	}
+
+	if (bProfile) {
+		Profiler::get().record("job " + name, (ofGetElapsedTimeMicros() - start) / 1000.0f);
+	}
+}
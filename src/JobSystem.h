@@ -0,0 +1,80 @@
+#pragma once
+
+#include "ofMain.h"
+#include <condition_variable>
+#include <deque>
+
+typedef int JobId;
+
+// How long a job of the last run() took, and on which thread (0 is the caller's)
+struct JobTiming {
+	string name;
+	float ms;
+	int thread;
+};
+
+/*
+ * JobSystem runs small pieces of per-tick work on a pool of worker threads.
+ *
+ * A graph of jobs is built with add(), each naming the jobs it has to wait for,
+ * and run() carries it out: jobs start as soon as their dependencies are done,
+ * so independent stages overlap, and the calling thread works along until the
+ * whole graph has finished. parallelFor() fans a loop out in chunks and may be
+ * called from inside a job.
+ *
+ * Every thread has its own queue. Threads take the newest job from their own
+ * queue and, when it runs dry, steal the oldest job from another thread's, so
+ * work spreads out without one shared queue everyone contends over.
+ *
+ * Jobs are timed; each one's smoothed time shows in the Profiler as "job <name>".
+ */
+class JobSystem {
+private:
+	struct Job {
+		string name;
+		function<void()> work;
+		atomic<int> numWaiting{ 0 };  // dependencies not yet done
+		vector<Job*> dependents;
+		atomic<int>* remaining = NULL; // of the graph or loop the job belongs to
+		float ms = 0;
+		int thread = 0;
+	};
+
+	struct Queue {
+		mutex queueMutex;
+		deque<Job*> jobs;
+	};
+
+	void threadedFunction(int index);
+	int getThreadIndex() const;
+	void push(Job* job);
+	Job* pop(int index);
+	void execute(Job* job, int index);
+	void workUntilDone(const atomic<int>& remaining);
+
+	vector<thread> workers;
+	vector<unique_ptr<Queue>> queues; // queues[0] is shared by threads outside the pool
+	atomic<int> numQueued{ 0 };
+	mutex sleepMutex;
+	condition_variable sleepCondition;
+	bool bStop = false;
+
+	// The graph being built, and the timings of the last one run
+	deque<Job> graph;
+	vector<JobTiming> timings;
+public:
+	JobSystem();
+	~JobSystem() { stop(); }
+
+	void start(int numThreads);
+	void stop();
+	int getNumThreads() const { return (int)workers.size(); }
+
+	JobId add(const string& name, function<void()> work, initializer_list<JobId> dependencies = {});
+	void run();
+
+	void parallelFor(const string& name, int count, int grain, function<void(int begin, int end)> body);
+
+	const vector<JobTiming>& getTimings() const { return timings; }
+	bool bProfile = true; // record every job's time in the Profiler
+};
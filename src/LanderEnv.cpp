@@ -0,0 +1,331 @@
+#include "LanderEnv.h"
+#include "LanderEnvC.h"
+#include "Profiler.h"
+
+/* setup() creates numEnvs simulations over terrain and starts the worker pool.
+ * The calling thread works on every batch too, so numThreads - 1 workers are
+ * started. */
+void LanderEnv::setup(SimTerrain* terrain, int numEnvs, int numThreads) {
+	stop();
+	this->terrain = terrain;
+
+	sims.clear();
+	for (int i = 0; i < numEnvs; i++) {
+		sims.push_back(unique_ptr<Simulation>(new Simulation()));
+		sims.back()->bEffects = false;
+		sims.back()->setTerrain(&terrain->octree, &terrain->heightfield);
+	}
+	episodes.assign(numEnvs, 0);
+	targets.assign(numEnvs, -1);
+	distances.assign(numEnvs, 0);
+	rewards.assign(numEnvs, 0);
+	dones.assign(numEnvs, 0);
+	if (probeDirections.size() == 0) {
+		setProbes(5, 45, 50);
+	}
+	observations.assign(numEnvs * getObservationSize(), 0);
+
+	bStop = false;
+	batch = 0;
+	for (int i = 1; i < numThreads; i++) {
+		workers.push_back(thread(&LanderEnv::threadedFunction, this));
+	}
+}
+
+/* setProbes() sets up the terrain probes: one straight down, the rest spread evenly
+ * around the lander, angle degrees off vertical and turning with it. A probe that
+ * finds no terrain within range reads range. */
+void LanderEnv::setProbes(int numProbes, float angle, float range) {
+	this->numProbes = max(numProbes, 0);
+	probeRange = range;
+	probeDirections.clear();
+	for (int i = 0; i < this->numProbes; i++) {
+		if (i == 0) {
+			probeDirections.push_back(ofVec3f(0, -1, 0));
+			continue;
+		}
+		float around = glm::radians(360.0f * (i - 1) / (this->numProbes - 1));
+		float down = glm::radians(angle);
+		probeDirections.push_back(ofVec3f(sinf(down) * sinf(around), -cosf(down), sinf(down) * cosf(around)));
+	}
+	observations.assign(sims.size() * getObservationSize(), 0);
+}
+
+void LanderEnv::stop() {
+	{
+		lock_guard<mutex> lock(poolMutex);
+		bStop = true;
+	}
+	startCondition.notify_all();
+	for (int i = 0; i < workers.size(); i++) {
+		workers[i].join();
+	}
+	workers.clear();
+}
+
+// Start every environment on its first episode from seed
+void LanderEnv::reset(uint64_t seed) {
+	this->seed = seed;
+	episodes.assign(sims.size(), 0);
+	runBatch([this](int i) {
+		resetEnv(i);
+		rewards[i] = 0;
+		dones[i] = 0;
+		observe(i);
+	});
+}
+
+// Advance every environment one tick with its action, numEnvs INPUT_* words
+void LanderEnv::step(const uint32_t* actions) {
+	ProfileScope scope("env step");
+	runBatch([this, actions](int i) {
+		stepEnv(i, actions[i]);
+		observe(i);
+	});
+}
+
+// Draw the start conditions of environment i's next episode and start it
+void LanderEnv::resetEnv(int i) {
+	Simulation& sim = *sims[i];
+	uint64_t episodeSeed = seed + i + episodes[i] * sims.size();
+	episodes[i]++;
+
+	SimRandom draw(episodeSeed);
+	sim.setEnvironment(env);
+	sim.startPosition = ofVec3f(startX.sample(draw), startY.sample(draw), startZ.sample(draw));
+	sim.reset(episodeSeed);
+	sim.start(episodeSeed);
+
+	targets[i] = sim.getNearestArea();
+	distances[i] = targetDistance(i);
+}
+
+/* stepEnv() steps environment i and scores the tick: the distance closed on the
+ * target and the landing bonus, less the fuel burnt and a crash penalty. */
+void LanderEnv::stepEnv(int i, uint32_t action) {
+	Simulation& sim = *sims[i];
+	float fuel = sim.fuel;
+	sim.step(action);
+
+	float reward = -fuelPenalty * (fuel - sim.fuel);
+	if (sim.events & EVENT_LANDED) reward += landingReward;
+	if (sim.events & EVENT_EXPLODED) reward -= crashPenalty;
+
+	// Progress only counts towards the same target, a new one starts from scratch
+	float distance = targetDistance(i);
+	if (sim.getNearestArea() == targets[i]) {
+		reward += progressReward * (distances[i] - distance);
+	}
+	else {
+		targets[i] = sim.getNearestArea();
+		distance = targetDistance(i);
+	}
+	distances[i] = distance;
+
+	bool done = sim.state != INGAME || sim.time >= maxEpisodeTime ||
+		(bEndOnLanding && (sim.events & EVENT_LANDED));
+	rewards[i] = reward;
+	dones[i] = done;
+	if (done) {
+		resetEnv(i);
+	}
+}
+
+float LanderEnv::targetDistance(int i) const {
+	const Simulation& sim = *sims[i];
+	if (targets[i] < 0) return 0;
+	return sim.lander.position.distance(sim.landingAreas[targets[i]]);
+}
+
+// Write environment i's observation into its block of observations
+void LanderEnv::observe(int i) {
+	const Simulation& sim = *sims[i];
+	const LunarLander& lander = sim.lander;
+	float* obs = &observations[i * getObservationSize()];
+
+	obs[OBS_POSITION] = lander.position.x;
+	obs[OBS_POSITION + 1] = lander.position.y;
+	obs[OBS_POSITION + 2] = lander.position.z;
+
+	ofVec3f offset(0, 0, 0);
+	if (targets[i] >= 0) offset = lander.position - sim.landingAreas[targets[i]];
+	obs[OBS_TARGET_OFFSET] = offset.x;
+	obs[OBS_TARGET_OFFSET + 1] = offset.y;
+	obs[OBS_TARGET_OFFSET + 2] = offset.z;
+
+	obs[OBS_VELOCITY] = lander.velocity.x;
+	obs[OBS_VELOCITY + 1] = lander.velocity.y;
+	obs[OBS_VELOCITY + 2] = lander.velocity.z;
+
+	float heading = glm::radians(lander.rotation);
+	float s = sinf(heading);
+	float c = cosf(heading);
+	obs[OBS_HEADING] = s;
+	obs[OBS_HEADING + 1] = c;
+	obs[OBS_ANGULAR_VELOCITY] = lander.angularVelocity;
+	obs[OBS_FUEL] = sim.fuel;
+	obs[OBS_AGL] = sim.getAGL();
+
+	// Probes turn with the lander about the y axis, the way its thrusters do, and
+	// are cast through the octree together
+	static thread_local vector<Ray> rays;
+	rays.resize(numProbes);
+	Vector3 origin = lander.position;
+	for (int p = 0; p < numProbes; p++) {
+		const ofVec3f& d = probeDirections[p];
+		rays[p] = Ray(origin, Vector3(d.x * c + d.z * s, d.y, d.z * c - d.x * s));
+	}
+	terrain->octree.raycast(rays.data(), numProbes, probeRange, &obs[OBS_PROBES]);
+}
+
+/* runBatch() calls work for every environment, handing them out in chunks to the
+ * workers and the calling thread, and returns once all are done. */
+void LanderEnv::runBatch(function<void(int)> work) {
+	{
+		lock_guard<mutex> lock(poolMutex);
+		batchWork = work;
+		nextEnv = 0;
+		numBusy = (int)workers.size();
+		batch++;
+	}
+	startCondition.notify_all();
+
+	workOnBatch();
+
+	unique_lock<mutex> lock(poolMutex);
+	doneCondition.wait(lock, [this] { return numBusy == 0; });
+}
+
+// Take chunks of environments off the current batch until there are none left
+void LanderEnv::workOnBatch() {
+	const int chunk = 64;
+	int n = (int)sims.size();
+	for (int start = nextEnv.fetch_add(chunk); start < n; start = nextEnv.fetch_add(chunk)) {
+		for (int i = start; i < min(start + chunk, n); i++) {
+			batchWork(i);
+		}
+	}
+}
+
+void LanderEnv::threadedFunction() {
+	uint64_t lastBatch = 0;
+	while (true) {
+		{
+			unique_lock<mutex> lock(poolMutex);
+			startCondition.wait(lock, [&] { return bStop || batch != lastBatch; });
+			if (bStop) return;
+			lastBatch = batch;
+		}
+
+		workOnBatch();
+
+		{
+			lock_guard<mutex> lock(poolMutex);
+			numBusy--;
+		}
+		doneCondition.notify_one();
+	}
+}
+
+/* runEnvBenchmark() is the --env-benchmark command line front end. It steps a batch
+ * of environments with random actions and reports the rate. */
+int runEnvBenchmark(int argc, char** argv) {
+	int numEnvs = 1024;
+	int numThreads = max(1u, thread::hardware_concurrency());
+	int numSteps = 1000;
+	GameEnv env = DESERT;
+	string terrainPath;
+
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		string value = i + 1 < argc ? argv[i + 1] : "";
+		if (arg == "--env-benchmark") continue;
+		else if (arg == "--envs") numEnvs = max(1, ofToInt(value));
+		else if (arg == "--threads") numThreads = max(1, ofToInt(value));
+		else if (arg == "--steps") numSteps = max(1, ofToInt(value));
+		else if (arg == "--env") env = value == "moon" ? MOON : DESERT;
+		else if (arg == "--terrain") terrainPath = value;
+		else {
+			cout << "Error: Unknown option " << arg << endl;
+			return 1;
+		}
+		i++;
+	}
+
+	if (terrainPath.empty()) terrainPath = Simulation::getTerrainPath(env) + ".llmesh";
+	SimTerrain terrain;
+	if (!terrain.load(terrainPath)) return 1;
+
+	LanderEnv envs;
+	envs.env = env;
+	envs.setup(&terrain, numEnvs, numThreads);
+	envs.reset(1);
+
+	SimRandom random(1);
+	vector<uint32_t> actions(numEnvs);
+	uint64_t start = ofGetElapsedTimeMicros();
+	int episodes = 0;
+	for (int s = 0; s < numSteps; s++) {
+		for (int i = 0; i < numEnvs; i++) {
+			actions[i] = random.next() & 0xff;
+		}
+		envs.step(actions.data());
+		for (int i = 0; i < numEnvs; i++) {
+			episodes += envs.dones[i];
+		}
+	}
+	float seconds = (ofGetElapsedTimeMicros() - start) / 1e6f;
+
+	cout << numSteps << " steps of " << numEnvs << " environments on " << numThreads << " threads in "
+		<< seconds << " s (" << numSteps * (double)numEnvs / seconds / 1e6 << "M env steps/s, "
+		<< episodes << " episodes)" << endl;
+	return 0;
+}
+
+//--------------------------------------------------------------
+// C interface, see LanderEnvC.h
+
+struct LanderEnvHandle {
+	SimTerrain terrain;
+	LanderEnv env;
+};
+
+LanderEnvHandle* lander_env_create(const char* meshPackPath, int environment, int numEnvs, int numThreads) {
+	LanderEnvHandle* handle = new LanderEnvHandle();
+	if (!handle->terrain.load(meshPackPath)) {
+		delete handle;
+		return NULL;
+	}
+	handle->env.env = environment == LANDER_ENV_MOON ? MOON : DESERT;
+	handle->env.setup(&handle->terrain, numEnvs, numThreads);
+	return handle;
+}
+
+void lander_env_destroy(LanderEnvHandle* handle) {
+	delete handle;
+}
+
+int lander_env_num_envs(const LanderEnvHandle* handle) {
+	return handle->env.getNumEnvs();
+}
+
+int lander_env_observation_size(const LanderEnvHandle* handle) {
+	return handle->env.getObservationSize();
+}
+
+void lander_env_set_probes(LanderEnvHandle* handle, int numProbes, float angle, float range) {
+	handle->env.setProbes(numProbes, angle, range);
+}
+
+void lander_env_reset(LanderEnvHandle* handle, uint64_t seed, float* observations) {
+	handle->env.reset(seed);
+	copy(handle->env.observations.begin(), handle->env.observations.end(), observations);
+}
+
+void lander_env_step(LanderEnvHandle* handle, const uint32_t* actions, float* observations, float* rewards, uint8_t* dones) {
+	LanderEnv& env = handle->env;
+	env.step(actions);
+	copy(env.observations.begin(), env.observations.end(), observations);
+	copy(env.rewards.begin(), env.rewards.end(), rewards);
+	copy(env.dones.begin(), env.dones.end(), dones);
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "Simulation.h"
+#include "MonteCarlo.h"
+#include <condition_variable>
+#include <atomic>
+
+// Layout of one environment's observation, as offsets into its block of floats.
+// The target is the nearest landing area not landed on yet; probes are terrain
+// distances along the rays set up by setProbes().
+enum {
+	OBS_POSITION = 0,      // x, y, z
+	OBS_TARGET_OFFSET = 3, // x, y, z of the lander relative to the target
+	OBS_VELOCITY = 6,      // x, y, z
+	OBS_HEADING = 9,       // sin, cos of the lander's rotation
+	OBS_ANGULAR_VELOCITY = 11,
+	OBS_FUEL = 12,         // seconds left
+	OBS_AGL = 13,
+	OBS_PROBES = 14
+};
+
+/* LanderEnv runs a batch of simulations side by side for reinforcement learning,
+ * without a window. Every step takes one input word (INPUT_* bits) per environment,
+ * advances all of them one tick, spread over a pool of worker threads, and writes
+ * their observations, rewards and done flags into flat arrays. An environment that
+ * is done starts its next episode straight away, so the observation returned with
+ * done set is already the first one of the new episode.
+ *
+ * All environments share one read-only terrain. Episode k of environment i draws
+ * from seed + i + k * numEnvs, so a batch is reproducible for any thread count. */
+class LanderEnv {
+public:
+	~LanderEnv() { stop(); }
+
+	void setup(SimTerrain* terrain, int numEnvs, int numThreads);
+	void setProbes(int numProbes, float angle, float range);
+	void stop();
+
+	void reset(uint64_t seed);
+	void step(const uint32_t* actions);
+
+	int getNumEnvs() const { return (int)sims.size(); }
+	int getObservationSize() const { return OBS_PROBES + numProbes; }
+	const Simulation& getSimulation(int i) const { return *sims[i]; }
+
+	// Start conditions, drawn for every episode
+	GameEnv env = DESERT;
+	SampleRange startX = { -10, 10 };
+	SampleRange startY = { 10, 30 };
+	SampleRange startZ = { -10, 10 };
+	float maxEpisodeTime = 60;
+	bool bEndOnLanding = true; // end the episode on the first landing instead of all three
+
+	// Rewards
+	float landingReward = 100;
+	float crashPenalty = 100;
+	float fuelPenalty = 0.3f; // per second of fuel burnt
+	float progressReward = 1; // per unit of distance closed on the target
+
+	// Outputs of the last step or reset, numEnvs entries (observations: numEnvs
+	// blocks of getObservationSize() floats)
+	vector<float> observations;
+	vector<float> rewards;
+	vector<uint8_t> dones;
+
+private:
+	void resetEnv(int i);
+	void stepEnv(int i, uint32_t action);
+	void observe(int i);
+	float targetDistance(int i) const;
+	void runBatch(function<void(int)> work);
+	void workOnBatch();
+	void threadedFunction();
+
+	SimTerrain* terrain = NULL;
+	vector<unique_ptr<Simulation>> sims;
+	vector<uint64_t> episodes;
+	vector<int> targets;
+	vector<float> distances; // to the target, after the last step
+	uint64_t seed = 0;
+
+	int numProbes = 0;
+	vector<ofVec3f> probeDirections; // relative to the lander's heading
+	float probeRange = 50;
+
+	// Worker pool: every batch hands out environments in chunks until none are left
+	vector<thread> workers;
+	mutex poolMutex;
+	condition_variable startCondition, doneCondition;
+	function<void(int)> batchWork;
+	uint64_t batch = 0;
+	int numBusy = 0;
+	atomic<int> nextEnv;
+	bool bStop = false;
+};
+
+// Command line benchmark of the stepping rate, see README
+int runEnvBenchmark(int argc, char** argv);
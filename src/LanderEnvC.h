@@ -0,0 +1,43 @@
+#pragma once
+
+/*
+ * C interface to LanderEnv, for training from Python (ctypes, cffi) or any other
+ * language that can call C. Arrays are owned by the caller:
+ *   observations - numEnvs * lander_env_observation_size() floats, laid out as in
+ *                  the OBS_* offsets of LanderEnv.h
+ *   actions      - numEnvs INPUT_* words (Simulation.h)
+ *   rewards      - numEnvs floats
+ *   dones        - numEnvs bytes, 1 where an episode ended and the next one began
+ */
+
+#include <stdint.h>
+
+#ifdef _WIN32
+#define LANDER_ENV_API __declspec(dllexport)
+#else
+#define LANDER_ENV_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct LanderEnvHandle LanderEnvHandle;
+
+enum { LANDER_ENV_MOON = 0, LANDER_ENV_DESERT = 1 };
+
+// Load the packed terrain and set up numEnvs environments; NULL if the terrain can't be loaded
+LANDER_ENV_API LanderEnvHandle* lander_env_create(const char* meshPackPath, int environment, int numEnvs, int numThreads);
+LANDER_ENV_API void lander_env_destroy(LanderEnvHandle* handle);
+
+LANDER_ENV_API int lander_env_num_envs(const LanderEnvHandle* handle);
+LANDER_ENV_API int lander_env_observation_size(const LanderEnvHandle* handle);
+LANDER_ENV_API void lander_env_set_probes(LanderEnvHandle* handle, int numProbes, float angle, float range);
+
+LANDER_ENV_API void lander_env_reset(LanderEnvHandle* handle, uint64_t seed, float* observations);
+LANDER_ENV_API void lander_env_step(LanderEnvHandle* handle, const uint32_t* actions,
+	float* observations, float* rewards, uint8_t* dones);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,28 +1,21 @@
 #include "LunarLander.h"
 
 LunarLander::LunarLander() {
-	position = model.getPosition();
+	position.set(0, 0, 0);
 	mass = 10.0f;
 	radius = 3.0f;
-	rotation = model.getRotationAngle(1);
+	rotation = 0;
 }
 
 ofVec3f LunarLander::getPosition() {
-	return model.getPosition();
+	return position;
 }
 
 void LunarLander::setPosition(const ofVec3f& pos) {
-	model.setPosition(pos.x, pos.y, pos.z);
 	position = pos;
 }
 
-void LunarLander::integrate() {
-	float dt = 1.0f / ofGetFrameRate();
-
-	if (isnan(dt) || isinf(dt)) {
-		return;
-	}
-
+void LunarLander::integrate(float dt) {
 	// apply linear motion forces
 	glm::vec3 pos = position + velocity * dt;
 	setPosition(pos);
@@ -61,12 +54,14 @@ float LunarLander::getRotationAngle() {
 }
 
 void LunarLander::setRotationAngle(float a) {
-	model.setRotation(
-		1, a, 0, 1, 0
-	);
 	rotation = a;
 }
 
+// Bounding box of the lander model, optionally scaled about the lander's position
+Box LunarLander::getBounds(float scale) {
+	return Box(sceneMin * scale + position, sceneMax * scale + position);
+}
+
 ofVec3f LunarLander::getForwardUV() {
 	glm::mat4 rotationMatrix = glm::rotate(glm::mat4(1.0), glm::radians(rotation), glm::vec3(0, 1, 0));
 	glm::vec3 directionUV = glm::normalize(rotationMatrix * glm::vec4(0, 0, 1, 1));
@@ -1,19 +1,26 @@
 #pragma once
 #include "ofMain.h"
 #include "PhysicsObject.h"
-#include "ofxAssimpModelLoader.h"
+#include "box.h"
 
+// LunarLander holds the lander's physical state only. The model it is drawn with
+// belongs to the app, which copies position and rotation onto it every frame,
+// so the lander can also be simulated without a window.
 class LunarLander : public PhysicsObject {
 public:
 	LunarLander();
-	ofxAssimpModelLoader model;
-	void integrate();
+
+	// Bounds of the lander model relative to its position
+	ofVec3f sceneMin, sceneMax;
+
+	void integrate(float dt);
 	ofVec3f getPosition();
 	void setPosition(const ofVec3f&);
 	float getRotationAngle();
 	void setRotationAngle(float);
+	Box getBounds(float scale = 1.0f);
 	ofVec3f getForwardUV();
 	ofVec3f getBackwardUV();
 	ofVec3f getLeftUV();
 	ofVec3f getRightUV();
-};
\ No newline at end of file
+};
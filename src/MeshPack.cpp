@@ -0,0 +1,188 @@
+#include "MeshPack.h"
+#include <cstring>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// Pad the stream to the next 4 byte boundary
+static void writePadding(ofstream& out, size_t bytes) {
+	static const char zeros[4] = { 0, 0, 0, 0 };
+	out.write(zeros, ((bytes + 3) & ~(size_t)3) - bytes);
+}
+
+/* writeMeshPack() quantizes the mesh against its bounding box and writes it out. */
+bool writeMeshPack(const string& path, const MeshPackData& data) {
+	uint32_t numVertices = (uint32_t)(data.positions.size() / 3);
+
+	MeshPackHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "LLMP", 4);
+	header.version = 2;
+	header.numVertices = numVertices;
+	header.numIndices = (uint32_t)data.indices.size();
+	header.numSubmeshes = (uint32_t)data.submeshes.size();
+	if (data.normals.size() == data.positions.size()) header.flags |= MESHPACK_NORMALS;
+	if (data.texcoords.size() == numVertices * 2) header.flags |= MESHPACK_TEXCOORDS;
+
+	for (int k = 0; k < 3; k++) {
+		header.boundsMin[k] = numVertices > 0 ? data.positions[k] : 0;
+		header.boundsMax[k] = header.boundsMin[k];
+	}
+	for (uint32_t i = 0; i < numVertices; i++) {
+		for (int k = 0; k < 3; k++) {
+			header.boundsMin[k] = min(header.boundsMin[k], data.positions[3 * i + k]);
+			header.boundsMax[k] = max(header.boundsMax[k], data.positions[3 * i + k]);
+		}
+	}
+
+	vector<uint16_t> positions(numVertices * 3);
+	for (uint32_t i = 0; i < numVertices; i++) {
+		for (int k = 0; k < 3; k++) {
+			float extent = header.boundsMax[k] - header.boundsMin[k];
+			float t = extent > 0 ? (data.positions[3 * i + k] - header.boundsMin[k]) / extent : 0;
+			positions[3 * i + k] = (uint16_t)lroundf(t * 65535.0f);
+		}
+	}
+
+	vector<int8_t> normals;
+	if (header.flags & MESHPACK_NORMALS) {
+		normals.resize(numVertices * 4, 0);
+		for (uint32_t i = 0; i < numVertices; i++) {
+			for (int k = 0; k < 3; k++) {
+				float n = max(-1.0f, min(1.0f, data.normals[3 * i + k]));
+				normals[4 * i + k] = (int8_t)lroundf(n * 127.0f);
+			}
+		}
+	}
+
+	ofstream out(path, ios::binary);
+	out.write((const char*)&header, sizeof(header));
+	out.write((const char*)data.submeshes.data(), data.submeshes.size() * sizeof(MeshPackSubmesh));
+	out.write((const char*)positions.data(), positions.size() * sizeof(uint16_t));
+	writePadding(out, positions.size() * sizeof(uint16_t));
+	out.write((const char*)normals.data(), normals.size());
+	if (header.flags & MESHPACK_TEXCOORDS) {
+		out.write((const char*)data.texcoords.data(), data.texcoords.size() * sizeof(float));
+	}
+	out.write((const char*)data.indices.data(), data.indices.size() * sizeof(uint32_t));
+	return (bool)out;
+}
+
+/* open() maps the file and checks that its sections fit inside it. */
+bool MeshPackFile::open(const string& path) {
+	close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) return false;
+	LARGE_INTEGER size;
+	GetFileSizeEx(file, &size);
+	HANDLE map = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (map == NULL) {
+		CloseHandle(file);
+		return false;
+	}
+	fileHandle = file;
+	mapHandle = map;
+	mappedSize = (size_t)size.QuadPart;
+	mapping = MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0);
+#else
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) return false;
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		::close(fd);
+		return false;
+	}
+	mappedSize = (size_t)st.st_size;
+	mapping = mmap(NULL, mappedSize, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (mapping == MAP_FAILED) mapping = nullptr;
+#endif
+	if (mapping == nullptr || mappedSize < sizeof(MeshPackHeader)) {
+		close();
+		return false;
+	}
+
+	const char* base = (const char*)mapping;
+	header = (const MeshPackHeader*)base;
+	if (memcmp(header->magic, "LLMP", 4) != 0) {
+		cout << "Error: " << path << " is not a MeshPack file" << endl;
+		close();
+		return false;
+	}
+	if (header->version != 2) {
+		cout << "Error: " << path << " was packed by an older tools/meshpack, pack the model again" << endl;
+		close();
+		return false;
+	}
+
+	size_t offset = sizeof(MeshPackHeader);
+	submeshes = (const MeshPackSubmesh*)(base + offset);
+	offset += header->numSubmeshes * sizeof(MeshPackSubmesh);
+	positions = (const uint16_t*)(base + offset);
+	offset += sectionSize(header->numVertices * 3 * sizeof(uint16_t));
+	if (header->flags & MESHPACK_NORMALS) {
+		normals = (const int8_t*)(base + offset);
+		offset += header->numVertices * 4;
+	}
+	if (header->flags & MESHPACK_TEXCOORDS) {
+		texcoords = (const float*)(base + offset);
+		offset += header->numVertices * 2 * sizeof(float);
+	}
+	indices = (const uint32_t*)(base + offset);
+	offset += header->numIndices * sizeof(uint32_t);
+
+	if (offset > mappedSize) {
+		cout << "Error: MeshPack file " << path << " is truncated" << endl;
+		close();
+		return false;
+	}
+	for (uint32_t i = 0; i < header->numSubmeshes; i++) {
+		if ((uint64_t)submeshes[i].firstIndex + submeshes[i].numIndices > header->numIndices) {
+			cout << "Error: MeshPack file " << path << " has a submesh outside its indices" << endl;
+			close();
+			return false;
+		}
+	}
+	return true;
+}
+
+void MeshPackFile::close() {
+#ifdef _WIN32
+	if (mapping != nullptr) UnmapViewOfFile(mapping);
+	if (mapHandle != nullptr) CloseHandle(mapHandle);
+	if (fileHandle != nullptr) CloseHandle(fileHandle);
+	mapHandle = nullptr;
+	fileHandle = nullptr;
+#else
+	if (mapping != nullptr) munmap(mapping, mappedSize);
+#endif
+	mapping = nullptr;
+	mappedSize = 0;
+	header = nullptr;
+	submeshes = nullptr;
+	positions = nullptr;
+	normals = nullptr;
+	texcoords = nullptr;
+	indices = nullptr;
+}
+
+void MeshPackFile::getPosition(uint32_t i, float* xyz) const {
+	for (int k = 0; k < 3; k++) {
+		float extent = header->boundsMax[k] - header->boundsMin[k];
+		xyz[k] = header->boundsMin[k] + positions[3 * i + k] * (extent / 65535.0f);
+	}
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/*
+ * MeshPack is a compact binary mesh format for assets that are baked offline by
+ * tools/meshpack, so the app can skip Assimp at start-up:
+ *
+ *      MeshPackHeader
+ *      submeshes    numSubmeshes * MeshPackSubmesh
+ *      positions    numVertices * uint16[3]   quantized to the header bounds
+ *      normals      numVertices * int8[4]     snorm, w unused      (if MESHPACK_NORMALS)
+ *      texcoords    numVertices * float[2]                          (if MESHPACK_TEXCOORDS)
+ *      indices      numIndices  * uint32      triangles
+ *
+ * A model's meshes share the vertex and index sections. Each submesh is a range of
+ * the indices drawn with its own material and texture, so a model made of several
+ * meshes, like the lander, loads as one mesh and draws with a handful of calls.
+ *
+ * Every section starts on a 4 byte boundary. The file is memory mapped and read in
+ * place, so loading is a single dequantizing pass over the mapped sections.
+ */
+
+enum {
+	MESHPACK_NORMALS = 1 << 0,
+	MESHPACK_TEXCOORDS = 1 << 1
+};
+
+struct MeshPackHeader {
+	char magic[4];        // "LLMP"
+	uint32_t version;     // 2; version 1 files had one mesh and no materials
+	uint32_t flags;
+	uint32_t numVertices;
+	uint32_t numIndices;
+	uint32_t numSubmeshes;
+	float boundsMin[3];
+	float boundsMax[3];
+};
+
+// A range of the indices and the material it is drawn with
+struct MeshPackSubmesh {
+	uint32_t firstIndex;
+	uint32_t numIndices;
+	float diffuse[4];      // rgba
+	float ambient[4];
+	float specular[4];
+	float emissive[4];
+	float shininess;
+	char texturePath[128]; // diffuse texture relative to the data folder, may be empty
+};
+
+// Uncompressed mesh as handed to the writer
+struct MeshPackData {
+	std::vector<float> positions; // xyz per vertex
+	std::vector<float> normals;   // xyz per vertex, or empty
+	std::vector<float> texcoords; // uv per vertex, or empty
+	std::vector<uint32_t> indices;
+	std::vector<MeshPackSubmesh> submeshes; // covering indices
+};
+
+bool writeMeshPack(const std::string& path, const MeshPackData& data);
+
+// Read-only memory mapping of a MeshPack file
+class MeshPackFile {
+private:
+	void* mapping = nullptr;
+	size_t mappedSize = 0;
+#ifdef _WIN32
+	void* fileHandle = nullptr;
+	void* mapHandle = nullptr;
+#endif
+	size_t sectionSize(size_t bytes) const { return (bytes + 3) & ~(size_t)3; }
+public:
+	~MeshPackFile() { close(); }
+
+	bool open(const std::string& path);
+	void close();
+
+	const MeshPackHeader* header = nullptr;
+	const MeshPackSubmesh* submeshes = nullptr;
+	const uint16_t* positions = nullptr;
+	const int8_t* normals = nullptr;
+	const float* texcoords = nullptr;
+	const uint32_t* indices = nullptr;
+
+	// Dequantize vertex i into xyz
+	void getPosition(uint32_t i, float* xyz) const;
+};
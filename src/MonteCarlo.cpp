@@ -0,0 +1,230 @@
+#include "MonteCarlo.h"
+#include "Autopilot.h"
+#include <atomic>
+#include <fstream>
+#include <cfloat>
+
+/* run() spreads numRuns landings over numThreads threads. */
+void MonteCarlo::run(SimTerrain& terrain, const Controller& controller) {
+	results.assign(numRuns, LandingResult());
+	atomic<int> next(0);
+
+	uint64_t start = ofGetElapsedTimeMicros();
+
+	auto worker = [&] {
+		Simulation sim;
+		sim.bEffects = false;
+		sim.setTerrain(&terrain.octree, &terrain.heightfield);
+		sim.setEnvironment(env);
+		if (bLanderBounds) {
+			sim.landerMin = landerMin;
+			sim.landerMax = landerMax;
+		}
+		unique_ptr<Controller> pilot(controller.clone());
+
+		for (int i = next++; i < numRuns; i = next++) {
+			runOne(sim, *pilot, i);
+		}
+	};
+
+	vector<thread> threads;
+	for (int i = 1; i < numThreads; i++) {
+		threads.push_back(thread(worker));
+	}
+	worker();
+	for (int i = 0; i < threads.size(); i++) {
+		threads[i].join();
+	}
+
+	elapsedSeconds = (ofGetElapsedTimeMicros() - start) / 1e6f;
+}
+
+// Fly one landing from start conditions drawn for run index
+void MonteCarlo::runOne(Simulation& sim, Controller& controller, int index) {
+	SimRandom draw(seed + index);
+	LandingResult& result = results[index];
+
+	result.start = ofVec3f(startX.sample(draw), startY.sample(draw), startZ.sample(draw));
+	result.mass = mass.sample(draw);
+	result.gravity = gravity.sample(draw);
+	result.turbulence = turbulence.sample(draw);
+
+	sim.startPosition = result.start;
+	sim.landerMass = result.mass;
+	sim.gravity = result.gravity;
+	sim.turbulenceMin = ofVec3f(-result.turbulence, -result.turbulence, -result.turbulence);
+	sim.turbulenceMax = ofVec3f(result.turbulence, result.turbulence, result.turbulence);
+	sim.reset(seed + index);
+	sim.start(seed + index);
+	controller.begin(sim);
+
+	uint32_t maxTicks = (uint32_t)(maxFlightTime / sim.dt);
+	result.outcome = TimeoutOutcome;
+	result.impactSpeed = 0;
+
+	uint32_t tick = 0;
+	while (tick < maxTicks) {
+		sim.step(controller.update(sim));
+		tick++;
+
+		if (sim.events & EVENT_TOUCHDOWN) {
+			result.impactSpeed = sim.impactSpeed;
+			if (sim.shipExploded) result.outcome = CrashedOutcome;
+			else if (sim.events & EVENT_LANDED) result.outcome = LandedOutcome;
+			else result.outcome = TouchdownOutcome;
+			break;
+		}
+		if (sim.state == ENDGAME) {
+			result.outcome = NoFuelOutcome;
+			break;
+		}
+	}
+
+	result.ticks = tick;
+	result.flightTime = tick * sim.dt;
+	result.fuelUsed = sim.startFuel - sim.fuel;
+}
+
+// p-th percentile of the values, which get sorted
+static float percentile(vector<float>& values, float p) {
+	if (values.size() == 0) return 0;
+	sort(values.begin(), values.end());
+	return values[(size_t)(p * (values.size() - 1) + 0.5f)];
+}
+
+static void reportDistribution(ostream& out, const string& name, vector<float>& values) {
+	float sum = 0;
+	for (int i = 0; i < values.size(); i++) sum += values[i];
+	out << name << "mean " << (values.size() > 0 ? sum / values.size() : 0)
+		<< "  p5 " << percentile(values, 0.05f)
+		<< "  p50 " << percentile(values, 0.5f)
+		<< "  p95 " << percentile(values, 0.95f) << endl;
+}
+
+/* report() prints success rates and the fuel use and touchdown speed distributions. */
+void MonteCarlo::report(ostream& out) const {
+	const char* names[] = { "landed on an area", "touched down", "crashed", "out of fuel", "timed out" };
+	int counts[5] = { 0, 0, 0, 0, 0 };
+	uint64_t ticks = 0;
+	vector<float> fuel, speeds;
+	for (int i = 0; i < results.size(); i++) {
+		counts[results[i].outcome]++;
+		ticks += results[i].ticks;
+		fuel.push_back(results[i].fuelUsed);
+		if (results[i].outcome <= CrashedOutcome) speeds.push_back(results[i].impactSpeed);
+	}
+
+	out << fixed << setprecision(2);
+	out << results.size() << " runs on " << numThreads << " threads in " << elapsedSeconds << " s ("
+		<< results.size() / elapsedSeconds << " runs/s, " << ticks / elapsedSeconds / 1e6f << "M ticks/s)" << endl;
+	for (int i = 0; i < 5; i++) {
+		out << "  " << left << setw(20) << names[i] << right << setw(7)
+			<< 100.0f * counts[i] / max((size_t)1, results.size()) << "%" << endl;
+	}
+	reportDistribution(out, "fuel used (s):      ", fuel);
+	reportDistribution(out, "touchdown speed:    ", speeds);
+
+	// Touchdown speeds in bins of 0.5, with the crash threshold at 2.5
+	int bins[8] = { 0 };
+	for (int i = 0; i < speeds.size(); i++) {
+		bins[min(7, (int)(speeds[i] / 0.5f))]++;
+	}
+	for (int i = 0; i < 8; i++) {
+		int bar = speeds.size() > 0 ? 50 * bins[i] / (int)speeds.size() : 0;
+		out << "  " << setw(4) << i * 0.5f << (i < 7 ? " - " + ofToString(i * 0.5f + 0.5f, 1) : " +   ")
+			<< " " << setw(6) << bins[i] << " " << string(bar, '#') << endl;
+	}
+}
+
+// One row per run, for further analysis
+bool MonteCarlo::writeCsv(const string& path) const {
+	ofstream out(path);
+	out << "outcome,fuel_used,impact_speed,flight_time,start_x,start_y,start_z,mass,gravity,turbulence" << endl;
+	for (int i = 0; i < results.size(); i++) {
+		const LandingResult& r = results[i];
+		out << r.outcome << "," << r.fuelUsed << "," << r.impactSpeed << "," << r.flightTime << ","
+			<< r.start.x << "," << r.start.y << "," << r.start.z << ","
+			<< r.mass << "," << r.gravity << "," << r.turbulence << endl;
+	}
+	return (bool)out;
+}
+
+// Parse "min:max", or a single value for a fixed setting
+static SampleRange parseRange(const string& arg) {
+	size_t colon = arg.find(':', 1);
+	if (colon == string::npos) {
+		float v = ofToFloat(arg);
+		return { v, v };
+	}
+	return { ofToFloat(arg.substr(0, colon)), ofToFloat(arg.substr(colon + 1)) };
+}
+
+/* runMonteCarlo() is the --montecarlo command line front end. */
+int runMonteCarlo(int argc, char** argv) {
+	MonteCarlo mc;
+	mc.numThreads = max(1u, thread::hardware_concurrency());
+	string controllerName = "descent";
+	string terrainPath;
+	string csvPath;
+
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		string value = i + 1 < argc ? argv[i + 1] : "";
+		if (arg == "--montecarlo") continue;
+		else if (arg == "--runs") mc.numRuns = ofToInt(value);
+		else if (arg == "--threads") mc.numThreads = max(1, ofToInt(value));
+		else if (arg == "--seed") mc.seed = ofToInt(value);
+		else if (arg == "--controller") controllerName = value;
+		else if (arg == "--env") mc.env = value == "moon" ? MOON : DESERT;
+		else if (arg == "--terrain") terrainPath = value;
+		else if (arg == "--x") mc.startX = parseRange(value);
+		else if (arg == "--y") mc.startY = parseRange(value);
+		else if (arg == "--z") mc.startZ = parseRange(value);
+		else if (arg == "--mass") mc.mass = parseRange(value);
+		else if (arg == "--gravity") mc.gravity = parseRange(value);
+		else if (arg == "--turbulence") mc.turbulence = parseRange(value);
+		else if (arg == "--max-time") mc.maxFlightTime = ofToFloat(value);
+		else if (arg == "--csv") csvPath = value;
+		else {
+			cout << "Error: Unknown option " << arg << endl;
+			return 1;
+		}
+		i++;
+	}
+
+	unique_ptr<Controller> controller;
+	if (controllerName == "descent") {
+		controller.reset(new DescentController());
+	}
+	else if (controllerName == "autopilot") {
+		// The runs already use every core, so each autopilot plans on its own
+		// thread, without a job system
+		Autopilot* autopilot = new Autopilot();
+		autopilot->budgetMicros = FLT_MAX;
+		controller.reset(autopilot);
+	}
+	else {
+		// Anything else is a recorded flight to fly from every start
+		ScriptedController* script = new ScriptedController();
+		controller.reset(script);
+		if (!script->load(controllerName)) return 1;
+
+		// Fly the lander the flight was recorded with
+		const FlightHeader& h = script->header;
+		mc.bLanderBounds = true;
+		mc.landerMin = ofVec3f(h.landerMin[0], h.landerMin[1], h.landerMin[2]);
+		mc.landerMax = ofVec3f(h.landerMax[0], h.landerMax[1], h.landerMax[2]);
+	}
+
+	if (terrainPath.empty()) terrainPath = Simulation::getTerrainPath(mc.env) + ".llmesh";
+	SimTerrain terrain;
+	if (!terrain.load(terrainPath)) return 1;
+
+	mc.run(terrain, *controller);
+	mc.report(cout);
+	if (!csvPath.empty() && !mc.writeCsv(csvPath)) {
+		cout << "Error: Can't write " << csvPath << endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Simulation.h"
+#include "Controller.h"
+
+// Range a Monte Carlo setting is drawn from, uniformly
+struct SampleRange {
+	float min, max;
+	float sample(SimRandom& rng) const { return min == max ? min : rng.range(min, max); }
+};
+
+typedef enum { LandedOutcome, TouchdownOutcome, CrashedOutcome, NoFuelOutcome, TimeoutOutcome } LandingOutcome;
+
+// How one simulated landing went, and what it started from
+struct LandingResult {
+	LandingOutcome outcome;
+	float fuelUsed;
+	float impactSpeed;
+	float flightTime;
+	uint32_t ticks;
+	ofVec3f start;
+	float mass;
+	float gravity;
+	float turbulence;
+};
+
+// MonteCarlo flies a controller from many randomly drawn start conditions and
+// collects how each landing went. Every thread runs its own simulation over the
+// shared, read-only terrain, and run i always draws from seed + i, so results do
+// not depend on the number of threads.
+class MonteCarlo {
+public:
+	SampleRange startX = { -10, 10 };
+	SampleRange startY = { 10, 30 };
+	SampleRange startZ = { -10, 10 };
+	SampleRange mass = { 10, 10 };
+	SampleRange gravity = { 1.64f, 1.64f };
+	SampleRange turbulence = { 2, 2 }; // bound of the turbulence on each axis
+	GameEnv env = DESERT;
+	bool bLanderBounds = false; // use the lander extent below instead of the default
+	ofVec3f landerMin, landerMax;
+	float maxFlightTime = 120;
+	int numRuns = 1000;
+	int numThreads = 1;
+	uint64_t seed = 1;
+
+	void run(SimTerrain& terrain, const Controller& controller);
+	void report(ostream& out) const;
+	bool writeCsv(const string& path) const;
+
+	vector<LandingResult> results;
+	float elapsedSeconds = 0;
+
+private:
+	void runOne(Simulation& sim, Controller& controller, int index);
+};
+
+// Command line front end, see README
+int runMonteCarlo(int argc, char** argv);
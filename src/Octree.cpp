@@ -18,47 +18,38 @@ void Octree::drawBox(const Box& box) {
 	Vector3 max = box.parameters[1];
 	Vector3 size = max - min;
 	Vector3 center = size / 2 + min;
-	ofVec3f p = ofVec3f(center.x(), center.y(), center.z());
 	float w = size.x();
 	float h = size.y();
 	float d = size.z();
-	ofDrawBox(p, w, h, d);
+	ofDrawBox(center, w, h, d);
 }
 
 // return a Mesh Bounding Box for the entire Mesh
 //
 Box Octree::meshBounds(const ofMesh& mesh) {
 	int n = mesh.getNumVertices();
-	ofVec3f v = mesh.getVertex(0);
-	ofVec3f max = v;
-	ofVec3f min = v;
+	const glm::vec3* verts = mesh.getVerticesPointer();
+	Vector3 max = verts[0];
+	Vector3 min = verts[0];
 	for (int i = 1; i < n; i++) {
-		ofVec3f v = mesh.getVertex(i);
-
-		if (v.x > max.x) max.x = v.x;
-		else if (v.x < min.x) min.x = v.x;
-
-		if (v.y > max.y) max.y = v.y;
-		else if (v.y < min.y) min.y = v.y;
-
-		if (v.z > max.z) max.z = v.z;
-		else if (v.z < min.z) min.z = v.z;
+		Vector3 v = verts[i];
+		min = Vector3::min(min, v);
+		max = Vector3::max(max, v);
 	}
 	cout << "vertices: " << n << endl;
 	//	cout << "min: " << min << "max: " << max << endl;
-	return Box(Vector3(min.x, min.y, min.z), Vector3(max.x, max.y, max.z));
+	return Box(min, max);
 }
 
 // getMeshPointsInBox:  return an array of indices to points in mesh that are contained 
 //                      inside the Box.  Return count of points found;
 //
-int Octree::getMeshPointsInBox(const ofMesh& mesh, const vector<int>& points,
-	Box& box, vector<int>& pointsRtn)
+int Octree::getMeshPointsInBox(const vector<int>& points, Box& box, vector<int>& pointsRtn)
 {
 	int count = 0;
 	for (int i = 0; i < points.size(); i++) {
-		ofVec3f v = mesh.getVertex(points[i]);
-		if (box.inside(Vector3(v.x, v.y, v.z))) {
+		const glm::vec3& v = vertices[points[i]];
+		if (box.inside(v.x, v.y, v.z)) {
 			count++;
 			pointsRtn.push_back(points[i]);
 		}
@@ -75,14 +66,10 @@ int Octree::getMeshFacesInBox(const ofMesh& mesh, const vector<int>& faces,
 	int count = 0;
 	for (int i = 0; i < faces.size(); i++) {
 		ofMeshFace face = mesh.getFace(faces[i]);
-		ofVec3f v[3];
-		v[0] = face.getVertex(0);
-		v[1] = face.getVertex(1);
-		v[2] = face.getVertex(2);
 		Vector3 p[3];
-		p[0] = Vector3(v[0].x, v[0].y, v[0].z);
-		p[1] = Vector3(v[1].x, v[1].y, v[1].z);
-		p[2] = Vector3(v[2].x, v[2].y, v[2].z);
+		p[0] = face.getVertex(0);
+		p[1] = face.getVertex(1);
+		p[2] = face.getVertex(2);
 		if (box.inside(p, 3)) {
 			count++;
 			facesRtn.push_back(faces[i]);
@@ -121,22 +108,38 @@ void Octree::subDivideBox8(const Box& box, vector<Box>& boxList) {
 }
 
 void Octree::create(const ofMesh& geo, int numLevels) {
-	// initialize octree structure
-	mesh = geo;
+	// initialize octree structure; the vertices are shared with geo, not copied
+	vertices = geo.getVerticesPointer();
+	numVertices = geo.getNumVertices();
+	levels = numLevels;
 	int level = 0;
-	root.box = meshBounds(mesh);
+	root = TreeNode();
+	root.box = meshBounds(geo);
 	if (!bUseFaces) {
-		for (int i = 0; i < mesh.getNumVertices(); i++) {
-			root.points.push_back(i);
+		root.points.resize(numVertices);
+		for (int i = 0; i < numVertices; i++) {
+			root.points[i] = i;
 		}
 	}
 
 	// recursively buid octree
 	level++;
-	subdivide(mesh, root, numLevels, level);
+	subdivide(root, numLevels, level);
+
+	// The dynamic index covers a cube over the terrain footprint so that objects
+	// flying above the terrain still fall inside the root node.
+	Vector3 size = root.box.max() - root.box.min();
+	float extent = max(size.x(), max(size.y(), size.z()));
+	Vector3 dynMin = root.box.min();
+	Box dynBox = Box(dynMin, dynMin + Vector3(extent, extent, extent));
+
+	dynNodes.clear();
+	freeDynNodes.clear();
+	dynObjects.clear();
+	allocDynamicNode(dynBox, -1, 0);
 }
 
-void Octree::subdivide(const ofMesh& mesh, TreeNode& node, int numLevels, int level) {
+void Octree::subdivide(TreeNode& node, int numLevels, int level) {
 	if (level >= numLevels) return;
 
 	// subdvide algorithm implemented here
@@ -148,13 +151,13 @@ void Octree::subdivide(const ofMesh& mesh, TreeNode& node, int numLevels, int le
 	// Sort point data into each box
 	for (int i = 0; i < subboxes.size(); i++) {
 		vector<int> points;
-		int pointCount = getMeshPointsInBox(mesh, node.points, subboxes[i], points);
+		int pointCount = getMeshPointsInBox(node.points, subboxes[i], points);
 
 		// if a child box contains at least 1 point, then add it to the tree
 		if (pointCount > 0) {
 			TreeNode newNode = TreeNode();
 			newNode.box = subboxes[i];
-			newNode.points = points;
+			newNode.points.swap(points);
 
 			node.children.push_back(newNode);
 		}
@@ -164,21 +167,22 @@ void Octree::subdivide(const ofMesh& mesh, TreeNode& node, int numLevels, int le
 	for (int i = 0; i < node.children.size(); i++) {
 		// If child has more than 1 point, it is not a leaf node.
 		if (node.children[i].points.size() > 1) {
-			subdivide(mesh, node.children[i], numLevels, level + 1);
+			subdivide(node.children[i], numLevels, level + 1);
 		}
 	}
 }
 
 /* intersect() function uses a ray and an octree, and selects the leaf node in the octree
- * that intersects with the ray */
-bool Octree::intersect(const Ray& ray, const TreeNode& node, TreeNode& nodeRtn) {
+ * that intersects with the ray. The node is handed back as a handle into the tree, with
+ * its depth counted from the node the search started at. */
+bool Octree::intersect(const Ray& ray, const TreeNode& node, NodeHandle& nodeRtn, int level) const {
 	bool intersects = false;
 
 	if (node.box.intersect(ray, 0, FLT_MAX)) {
 		// If node has children, it is not a leaf node, thus use recursion
 		if (node.children.size() > 0) {
 			for (int i = 0; i < node.children.size(); i++) {
-				if (intersect(ray, node.children[i], nodeRtn)) {
+				if (intersect(ray, node.children[i], nodeRtn, level + 1)) {
 					intersects = true;
 					break;
 				}
@@ -186,7 +190,7 @@ bool Octree::intersect(const Ray& ray, const TreeNode& node, TreeNode& nodeRtn)
 		}
 		else {
 			// Exit when a leaf node is selected
-			nodeRtn = node;
+			nodeRtn = NodeHandle(&node, level);
 			intersects = true;
 		}
 	}
@@ -194,29 +198,142 @@ bool Octree::intersect(const Ray& ray, const TreeNode& node, TreeNode& nodeRtn)
 	return intersects;
 }
 
-/* intersect() function uses a ray and an octree, and selects the node at depth level of numLevels
- * in the octree that intersects with the ray */
-bool Octree::intersect(const Ray& ray, const TreeNode& node, int numLevels, int level, TreeNode& nodeRtn) {
-	bool intersects = false;
+/* raycast() returns how far along the ray the terrain is, within maxDistance: the
+ * distance to the mesh point of the nearest leaf node the ray passes through, as
+ * computeAGL() measures it. Unlike intersect() it visits children nearest first and
+ * skips branches farther away than the nearest leaf found so far. The ray direction should be unit
+ * length for the result to be a distance. */
+bool Octree::raycast(const Ray& ray, float maxDistance, float& distanceRtn) const {
+	float distance;
+	raycast(&ray, 1, maxDistance, &distance);
+	if (distance >= maxDistance) return false;
+
+	distanceRtn = distance;
+	return true;
+}
 
-	if (node.box.intersect(ray, 0, FLT_MAX)) {
-		// If node has children and its depth level is not numLevels, then use recursion
-		if (node.children.size() > 0 && level < numLevels) {
-			for (int i = 0; i < node.children.size(); i++) {
-				if (intersect(ray, node.children[i], numLevels, level + 1, nodeRtn)) {
-					intersects = true;
-					break;
-				}
-			}
+void Octree::raycast(const Ray& ray, const TreeNode& node, int level, int numLevels, float& nearestRtn,
+	NodeHandle& nodeRtn) const {
+	// Visit the children the ray passes through nearest first, so that once a leaf
+	// is found the children behind it are skipped
+	float entries[8];
+	int order[8];
+	int count = 0;
+	for (int i = 0; i < node.children.size(); i++) {
+		float t;
+		if (!node.children[i].box.intersect(ray, 0, nearestRtn, t)) continue;
+
+		int j = count++;
+		for (; j > 0 && entries[j - 1] > t; j--) {
+			entries[j] = entries[j - 1];
+			order[j] = order[j - 1];
 		}
-		else {
-			// Exit when a node is either a leaf or is at depth numLevels.
-			nodeRtn = node;
-			intersects = true;
+		entries[j] = t;
+		order[j] = i;
+	}
+
+	for (int j = 0; j < count; j++) {
+		if (entries[j] >= nearestRtn) break;
+		const TreeNode& child = node.children[order[j]];
+		if (child.children.size() == 0 || level + 1 >= numLevels) {
+			// The ray may start inside the leaf
+			nearestRtn = max(entries[j], 0.0f);
+			nodeRtn = NodeHandle(&child, level + 1);
+			break;
 		}
+		raycast(ray, child, level + 1, numLevels, nearestRtn, nodeRtn);
 	}
+}
 
-	return intersects;
+/* raycast() for a batch of rays returns for each ray the distance to the terrain,
+ * or maxDistance. Nodes at depth numLevels (the root being depth 1) count as leaves
+ * and are measured to where the ray enters them, which gives coarser, shorter
+ * distances for less work.
+ * Each ray walks the tree front to back on its own: for the diverging rays of a
+ * sensor fan that beats walking them as a packet, where every ray still has to be
+ * tested against every child and loses its own nearest-first order. */
+void Octree::raycast(const Ray* rays, int numRays, float maxDistance, float* distancesRtn, int numLevels) const {
+	for (int r = 0; r < numRays; r++) {
+		distancesRtn[r] = raycastDistance(rays[r], maxDistance, numLevels);
+	}
+}
+
+// The same with a depth of its own for every ray, for rays that need different precision
+void Octree::raycast(const Ray* rays, int numRays, float maxDistance, float* distancesRtn, const int* levels) const {
+	for (int r = 0; r < numRays; r++) {
+		distancesRtn[r] = raycastDistance(rays[r], maxDistance, levels[r]);
+	}
+}
+
+float Octree::raycastDistance(const Ray& ray, float maxDistance, int numLevels) const {
+	NodeHandle node;
+	float distance;
+	if (!query(ray, maxDistance, numLevels, node, distance)) {
+		return maxDistance;
+	}
+
+	// A real leaf holds a single mesh point (or a few, at the bottom level)
+	if (node.isLeaf() && node.getNumPoints() > 0 && vertices != NULL) {
+		Vector3 toPoint = Vector3(vertices[node.getPoint(0)]) - ray.origin;
+		distance = ofClamp(toPoint * ray.direction, 0, maxDistance);
+	}
+	return distance;
+}
+
+/* query() finds the nearest node along the ray within maxDistance that is a leaf or
+ * at depth numLevels, and how far along the ray it starts (0 if the ray starts in
+ * it). Stopping higher up the tree costs less and gives a box that holds the part
+ * of the terrain the ray would have hit further down. */
+bool Octree::query(const Ray& ray, float maxDistance, int numLevels, NodeHandle& nodeRtn, float& distanceRtn) const {
+	float t;
+	if (!root.box.intersect(ray, 0, maxDistance, t)) return false;
+
+	if (root.children.size() == 0 || numLevels <= 1) {
+		nodeRtn = NodeHandle(&root, 1);
+		distanceRtn = max(t, 0.0f);
+		return true;
+	}
+
+	NodeHandle node;
+	float nearest = maxDistance;
+	raycast(ray, root, 1, numLevels, nearest, node);
+	if (!node.isValid()) return false;
+
+	nodeRtn = node;
+	distanceRtn = nearest;
+	return true;
+}
+
+/* query() for a box collects the nodes that overlap it, stopping at the leaves or at
+ * depth numLevels. A broad-phase check can stop a few levels down and only look
+ * closer where it found something. */
+void Octree::query(const Box& box, int numLevels, vector<NodeHandle>& nodesRtn) const {
+	query(box, root, 1, numLevels, nodesRtn);
+}
+
+void Octree::query(const Box& box, const TreeNode& node, int level, int numLevels, vector<NodeHandle>& nodesRtn) const {
+	if (!node.box.overlap(box)) return;
+
+	if (node.children.size() == 0 || level >= numLevels) {
+		nodesRtn.push_back(NodeHandle(&node, level));
+		return;
+	}
+	for (int i = 0; i < node.children.size(); i++) {
+		query(box, node.children[i], level + 1, numLevels, nodesRtn);
+	}
+}
+
+/* getLevelsForTolerance() returns how deep a query has to go for the nodes it stops
+ * at to be no larger than tolerance along any side. Each level halves the root's. */
+int Octree::getLevelsForTolerance(float tolerance) const {
+	Vector3 size = root.box.max() - root.box.min();
+	float extent = max(size.x(), max(size.y(), size.z()));
+	int numLevels = 1;
+	while (extent > tolerance && numLevels < levels) {
+		extent /= 2;
+		numLevels++;
+	}
+	return numLevels;
 }
 
 /* intersect() function takes a box and returns a list of all leaf node boxes that intersect
@@ -256,5 +373,231 @@ void Octree::draw(TreeNode& node, int numLevels, int level) {
 	}
 }
 
+/* insert() adds a dynamic object to the index, or moves it if the id is already present. */
+void Octree::insert(int id, const Box& box) {
+	// The dynamic index is set up by create()
+	if (dynNodes.empty()) return;
+
+	if (dynObjects.count(id) > 0) {
+		move(id, box);
+		return;
+	}
+
+	dynObjects[id].box = box;
+	insertObject(0, id);
+}
+
+/* move() updates the bounds of a dynamic object. The object is only re-filed when it
+ * leaves its node or fits into a child, and then only from the nearest ancestor that
+ * still contains it, so the rest of the tree is left untouched. */
+void Octree::move(int id, const Box& box) {
+	if (dynNodes.empty()) return;
+
+	if (dynObjects.count(id) == 0) {
+		insert(id, box);
+		return;
+	}
+
+	DynamicObject& obj = dynObjects[id];
+	obj.box = box;
+	int nodeIndex = obj.node;
+	const DynamicNode& node = dynNodes[nodeIndex];
+
+	if (node.looseBox.contains(box)) {
+		// Stay put unless the object now fits into one of the children
+		if (getDynamicChild(nodeIndex, box) < 0) return;
+
+		removeObject(id);
+		insertObject(nodeIndex, id);
+		return;
+	}
+
+	// Climb to the nearest ancestor that still holds the new bounds (or the root)
+	int ancestor = dynNodes[nodeIndex].parent;
+	while (ancestor > 0 && !dynNodes[ancestor].looseBox.contains(box)) {
+		ancestor = dynNodes[ancestor].parent;
+	}
+	if (ancestor < 0) ancestor = 0;
+
+	removeObject(id);
+	insertObject(ancestor, id);
+	mergeDynamicNodes(nodeIndex);
+}
+
+/* remove() deletes a dynamic object and collapses nodes that became sparse. */
+void Octree::remove(int id) {
+	if (dynObjects.count(id) == 0) return;
+
+	int nodeIndex = dynObjects[id].node;
+	removeObject(id);
+	dynObjects.erase(id);
+	mergeDynamicNodes(nodeIndex);
+}
+
+/* getObjectsInBox() returns the ids of all dynamic objects whose bounds overlap box. */
+int Octree::getObjectsInBox(const Box& box, vector<int>& objectsRtn) {
+	if (dynNodes.empty()) return 0;
+
+	int count = (int)objectsRtn.size();
+	getObjectsInBox(0, box, objectsRtn);
+	return (int)objectsRtn.size() - count;
+}
+
+void Octree::getObjectsInBox(int nodeIndex, const Box& box, vector<int>& objectsRtn) {
+	const DynamicNode& node = dynNodes[nodeIndex];
+
+	// The root also stores objects that left its bounds, so always test its list
+	if (nodeIndex != 0 && !node.looseBox.overlap(box)) return;
+
+	for (int i = 0; i < node.objects.size(); i++) {
+		if (dynObjects[node.objects[i]].box.overlap(box)) {
+			objectsRtn.push_back(node.objects[i]);
+		}
+	}
+
+	if (!node.isLeaf()) {
+		for (int i = 0; i < 8; i++) {
+			getObjectsInBox(node.children[i], box, objectsRtn);
+		}
+	}
+}
+
+// A dynamic node's loose bounds: its box grown by half its size on every side
+static Box loosenBox(const Box& box) {
+	Vector3 margin = (box.max() - box.min()) / 2;
+	return Box(box.min() - margin, box.max() + margin);
+}
+
+int Octree::allocDynamicNode(const Box& box, int parent, int depth) {
+	int index;
+	if (freeDynNodes.size() > 0) {
+		index = freeDynNodes.back();
+		freeDynNodes.pop_back();
+		dynNodes[index] = DynamicNode();
+	}
+	else {
+		index = (int)dynNodes.size();
+		dynNodes.push_back(DynamicNode());
+	}
+
+	dynNodes[index].box = box;
+	dynNodes[index].looseBox = loosenBox(box);
+	dynNodes[index].parent = parent;
+	dynNodes[index].depth = depth;
+	return index;
+}
+
+// The child of a split node an object with the given bounds belongs in, or -1 if
+// it is too big for the child its center falls in
+int Octree::getDynamicChild(int nodeIndex, const Box& box) const {
+	const DynamicNode& node = dynNodes[nodeIndex];
+	if (node.isLeaf()) return -1;
+
+	Vector3 center = box.center();
+	for (int i = 0; i < 8; i++) {
+		const DynamicNode& child = dynNodes[node.children[i]];
+		if (child.box.inside(center)) {
+			return child.looseBox.contains(box) ? node.children[i] : -1;
+		}
+	}
+	return -1;
+}
+
+/* insertObject() files an object into the deepest node below nodeIndex it belongs
+ * in, splitting that node if it becomes overfull. */
+void Octree::insertObject(int nodeIndex, int id) {
+	DynamicObject& obj = dynObjects[id];
+
+	for (int child = getDynamicChild(nodeIndex, obj.box); child >= 0; child = getDynamicChild(nodeIndex, obj.box)) {
+		nodeIndex = child;
+	}
+
+	dynNodes[nodeIndex].objects.push_back(id);
+	obj.node = nodeIndex;
+
+	if (dynNodes[nodeIndex].isLeaf() && dynNodes[nodeIndex].objects.size() > maxObjectsPerNode &&
+		dynNodes[nodeIndex].depth + 1 < maxDynamicLevels) {
+		splitDynamicNode(nodeIndex);
+	}
+}
+
+void Octree::removeObject(int id) {
+	DynamicNode& node = dynNodes[dynObjects[id].node];
+	for (int i = 0; i < node.objects.size(); i++) {
+		if (node.objects[i] == id) {
+			node.objects[i] = node.objects.back();
+			node.objects.pop_back();
+			break;
+		}
+	}
+	dynObjects[id].node = -1;
+}
+
+/* splitDynamicNode() gives a leaf eight children and pushes down every object
+ * that fits into one of them. A split that would move no object down is skipped,
+ * rather than leaving eight empty children. */
+void Octree::splitDynamicNode(int nodeIndex) {
+	vector<Box> subboxes;
+	subDivideBox8(dynNodes[nodeIndex].box, subboxes);
+
+	bool bMovesDown = false;
+	const vector<int>& current = dynNodes[nodeIndex].objects;
+	for (int i = 0; i < current.size() && !bMovesDown; i++) {
+		const Box& box = dynObjects[current[i]].box;
+		Vector3 center = box.center();
+		for (int j = 0; j < 8; j++) {
+			if (subboxes[j].inside(center)) {
+				bMovesDown = loosenBox(subboxes[j]).contains(box);
+				break;
+			}
+		}
+	}
+	if (!bMovesDown) return;
+
+	int depth = dynNodes[nodeIndex].depth + 1;
+	for (int i = 0; i < 8; i++) {
+		// allocDynamicNode() may grow the pool, so index it again after every call
+		int child = allocDynamicNode(subboxes[i], nodeIndex, depth);
+		dynNodes[nodeIndex].children[i] = child;
+	}
+
+	vector<int> objects;
+	objects.swap(dynNodes[nodeIndex].objects);
+	for (int i = 0; i < objects.size(); i++) {
+		insertObject(nodeIndex, objects[i]);
+	}
+}
+
+/* mergeDynamicNodes() walks up from nodeIndex and collapses every parent whose
+ * children are empty leaves and whose objects fit in a single node again. */
+void Octree::mergeDynamicNodes(int nodeIndex) {
+	int parent = dynNodes[nodeIndex].parent;
+	while (parent >= 0) {
+		DynamicNode& node = dynNodes[parent];
+
+		int count = (int)node.objects.size();
+		for (int i = 0; i < 8; i++) {
+			const DynamicNode& child = dynNodes[node.children[i]];
+			if (!child.isLeaf()) return;
+			count += (int)child.objects.size();
+		}
+		if (count > maxObjectsPerNode / 2) return;
+
+		for (int i = 0; i < 8; i++) {
+			int child = node.children[i];
+			for (int j = 0; j < dynNodes[child].objects.size(); j++) {
+				int id = dynNodes[child].objects[j];
+				node.objects.push_back(id);
+				dynObjects[id].node = parent;
+			}
+			dynNodes[child].objects.clear();
+			node.children[i] = -1;
+			freeDynNodes.push_back(child);
+		}
+
+		parent = node.parent;
+	}
+}
+
 // Optional to implement
 void Octree::drawLeafNodes(TreeNode& node) {}
\ No newline at end of file
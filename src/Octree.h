@@ -12,6 +12,7 @@
 #include "ofMain.h"
 #include "box.h"
 #include "ray.h"
+#include <climits>
 
 
 
@@ -22,13 +23,69 @@ public:
 	vector<TreeNode> children;
 };
 
+/* NodeHandle refers to a node of the octree, and the depth it is at, without
+ * copying it. It stays valid until the tree is created again. Every mesh point
+ * under a node lies in the node's box, so a query that stops at a coarse node
+ * returns bounds around whatever a deeper query would have found there. */
+class NodeHandle {
+public:
+	NodeHandle() { }
+	NodeHandle(const TreeNode* node, int level) : node(node), level(level) { }
+
+	bool isValid() const { return node != NULL; }
+	bool isLeaf() const { return node->children.size() == 0; }
+	int getLevel() const { return level; } // the root being 1
+	const Box& getBox() const { return node->box; }
+	int getNumPoints() const { return (int)node->points.size(); }
+	int getPoint(int i) const { return node->points[i]; } // mesh vertex index
+
+private:
+	const TreeNode* node = NULL;
+	int level = 0;
+};
+
+/* DynamicNode is a node of the dynamic object index. Nodes are kept in a pool and
+ * refer to each other by index, so splitting or merging one node never invalidates
+ * the others. A node that has been split always has all eight children.
+ *
+ * The index is a loose octree: an object is filed in the node its center falls in,
+ * as long as it fits into the node's looseBox, which is box grown by half its size
+ * on every side. Objects straddling a boundary between children still move down,
+ * and one that moves a little stays in its node. */
+class DynamicNode {
+public:
+	Box box;
+	Box looseBox;
+	vector<int> objects;
+	int children[8] = { -1, -1, -1, -1, -1, -1, -1, -1 };
+	int parent = -1;
+	int depth = 0;
+
+	bool isLeaf() const { return children[0] < 0; }
+};
+
+// Bounds of a dynamic object and the node that currently stores it
+class DynamicObject {
+public:
+	Box box;
+	int node = -1;
+};
+
 class Octree {
 public:
 
 	void create(const ofMesh& mesh, int numLevels);
-	void subdivide(const ofMesh& mesh, TreeNode& node, int numLevels, int level);
-	bool intersect(const Ray&, const TreeNode& node, TreeNode& nodeRtn);
+	void subdivide(TreeNode& node, int numLevels, int level);
+	bool intersect(const Ray&, const TreeNode& node, NodeHandle& nodeRtn, int level = 1) const;
 	bool intersect(const Box&, TreeNode& node, vector<Box>& boxListRtn);
+	bool raycast(const Ray& ray, float maxDistance, float& distanceRtn) const;
+	void raycast(const Ray* rays, int numRays, float maxDistance, float* distancesRtn, int numLevels = INT_MAX) const;
+	void raycast(const Ray* rays, int numRays, float maxDistance, float* distancesRtn, const int* levels) const;
+
+	// Coarse to fine queries, going no deeper than numLevels (the root being 1)
+	bool query(const Ray& ray, float maxDistance, int numLevels, NodeHandle& nodeRtn, float& distanceRtn) const;
+	void query(const Box& box, int numLevels, vector<NodeHandle>& nodesRtn) const;
+	int getLevelsForTolerance(float tolerance) const;
 	void draw(TreeNode& node, int numLevels, int level);
 	void draw(int numLevels, int level) {
 		draw(root, numLevels, level);
@@ -36,14 +93,33 @@ public:
 	void drawLeafNodes(TreeNode& node);
 	static void drawBox(const Box& box);
 	static Box meshBounds(const ofMesh&);
-	int getMeshPointsInBox(const ofMesh& mesh, const vector<int>& points, Box& box, vector<int>& pointsRtn);
+	int getMeshPointsInBox(const vector<int>& points, Box& box, vector<int>& pointsRtn);
 	int getMeshFacesInBox(const ofMesh& mesh, const vector<int>& faces, Box& box, vector<int>& facesRtn);
 	void subDivideBox8(const Box& b, vector<Box>& boxList);
 
-	ofMesh mesh;
+	// Dynamic objects (landers, debris, movable pads) indexed by a caller chosen id.
+	// Nothing in the game files objects yet; a single lander is cheaper to test directly.
+	void insert(int id, const Box& box);
+	void move(int id, const Box& box);
+	void remove(int id);
+	int getObjectsInBox(const Box& box, vector<int>& objectsRtn);
+
+	// Vertex positions of the mesh passed to create(). The tree only references
+	// them, so that mesh must outlive the tree and must not be modified.
+	const glm::vec3* vertices = NULL;
+	int numVertices = 0;
+	const glm::vec3& getVertex(int i) const { return vertices[i]; }
+
 	TreeNode root;
+	int levels = 0; // passed to create()
 	bool bUseFaces = false;
 
+	vector<DynamicNode> dynNodes;
+	vector<int> freeDynNodes;
+	map<int, DynamicObject> dynObjects;
+	int maxObjectsPerNode = 8;
+	int maxDynamicLevels = 8;
+
 	// debug;
 	//
 	int strayVerts = 0;
@@ -56,5 +132,16 @@ public:
 		ofColor::pink
 	};
 
-	bool intersect(const Ray&, const TreeNode& node, int numLevels, int level, TreeNode& nodeRtn);
+private:
+	void raycast(const Ray& ray, const TreeNode& node, int level, int numLevels, float& nearestRtn,
+		NodeHandle& nodeRtn) const;
+	float raycastDistance(const Ray& ray, float maxDistance, int numLevels) const;
+	void query(const Box& box, const TreeNode& node, int level, int numLevels, vector<NodeHandle>& nodesRtn) const;
+	int allocDynamicNode(const Box& box, int parent, int depth);
+	int getDynamicChild(int nodeIndex, const Box& box) const;
+	void insertObject(int nodeIndex, int id);
+	void removeObject(int id);
+	void splitDynamicNode(int nodeIndex);
+	void mergeDynamicNodes(int nodeIndex);
+	void getObjectsInBox(int nodeIndex, const Box& box, vector<int>& objectsRtn);
 };
\ No newline at end of file
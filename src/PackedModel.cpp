@@ -0,0 +1,51 @@
+#include "PackedModel.h"
+
+/* load() reads the pack, uploads it and loads the parts' textures. Must be called
+ * on the GL thread. */
+bool PackedModel::load(const string& path) {
+	ofMesh mesh;
+	if (!loadMeshPack(path, mesh, parts)) return false;
+
+	const vector<glm::vec3>& vertices = mesh.getVertices();
+	sceneMin = sceneMax = vertices.size() > 0 ? vertices[0] : glm::vec3(0);
+	for (int i = 1; i < vertices.size(); i++) {
+		sceneMin = glm::min(sceneMin, vertices[i]);
+		sceneMax = glm::max(sceneMax, vertices[i]);
+	}
+	vbo.setMesh(mesh, GL_STATIC_DRAW);
+
+	// Parts often share a texture, which is then loaded once
+	materials.clear();
+	textures.clear();
+	for (int i = 0; i < parts.size(); i++) {
+		materials.push_back(makeMaterial(parts[i]));
+		textures.push_back(ofTexture());
+		if (parts[i].texturePath.empty()) continue;
+
+		int j = 0;
+		while (j < i && parts[j].texturePath != parts[i].texturePath) j++;
+		if (j < i) {
+			textures[i] = textures[j];
+		}
+		else if (!ofLoadImage(textures[i], parts[i].texturePath)) {
+			cout << "Error: Can't load texture file: " << parts[i].texturePath << endl;
+		}
+	}
+	return true;
+}
+
+void PackedModel::drawFaces() const {
+	ofPushMatrix();
+	ofTranslate(position);
+	ofRotateDeg(rotation, 0, 1, 0);
+	ofScale(scale, scale, scale);
+	for (int i = 0; i < parts.size(); i++) {
+		bool bTextured = textures[i].isAllocated();
+		materials[i].begin();
+		if (bTextured) textures[i].bind();
+		vbo.drawElements(GL_TRIANGLES, parts[i].numIndices, parts[i].firstIndex);
+		if (bTextured) textures[i].unbind();
+		materials[i].end();
+	}
+	ofPopMatrix();
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "ofMain.h"
+#include "Util.h"
+
+/* PackedModel draws a model baked by tools/meshpack, in place of an
+ * ofxAssimpModelLoader when a packed copy of the model is there. All of the
+ * model's meshes are in one vbo; each part is a range of it drawn with its own
+ * material and texture. The model is scaled, turned about y and then moved to
+ * its position, the way the simulation places the lander's bounds. */
+class PackedModel {
+private:
+	ofVbo vbo;
+	vector<MeshPart> parts;
+	vector<ofMaterial> materials;
+	vector<ofTexture> textures;
+	glm::vec3 sceneMin, sceneMax;
+
+	glm::vec3 position;
+	float rotation = 0; // degrees about y
+	float scale = 1;
+public:
+	bool load(const string& path);
+
+	void setPosition(float x, float y, float z) { position = glm::vec3(x, y, z); }
+	void setRotation(float degrees) { rotation = degrees; }
+	void setScale(float s) { scale = s; }
+	void drawFaces() const;
+
+	// Bounds of the model before it is placed
+	glm::vec3 getSceneMin() const { return sceneMin; }
+	glm::vec3 getSceneMax() const { return sceneMax; }
+};
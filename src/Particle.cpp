@@ -13,25 +13,7 @@ Particle::Particle() {
 	color.set(245, 158, 11);
 }
 
-void Particle::draw() {
-	// Compute a value by how much to make the color darker
-	float darkeningFactor = ofMap(age(), 0, lifespan, 1.0f, 0.25f);
-
-	// Apply darkening factor
-	ofVec3f darkenedColor = color * darkeningFactor;
-
-	ofSetColor(darkenedColor.x, darkenedColor.y, darkenedColor.z);
-
-	ofDrawSphere(position, radius);
-}
-
-void Particle::integrate() {
-	float dt = 1.0 / ofGetFrameRate();
-
-	if (isnan(dt) || isinf(dt)) {
-		return;
-	}
-
+void Particle::integrate(float dt) {
 	// Update position
 	position += velocity * dt;
 
@@ -44,7 +26,7 @@ void Particle::integrate() {
 	forces.set(0, 0, 0);
 }
 
-// Get age of particle in seconds
-float Particle::age() {
-	return (ofGetElapsedTimeMillis() - birthtime) / 1000.0;
+// Get age of particle in seconds, at the given simulation time
+float Particle::age(float time) const {
+	return time - birthtime;
 }
\ No newline at end of file
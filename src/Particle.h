@@ -7,8 +7,7 @@ public:
 	Particle();
 	float   lifespan;
 	float   birthtime;
-	void    integrate();
-	void    draw();
-	float   age();
+	void    integrate(float dt);
+	float   age(float time) const;
 	ofVec3f color;
 };
\ No newline at end of file
@@ -15,15 +15,10 @@ void ParticleEmitter::stop() {
 	active = false;
 }
 
-void ParticleEmitter::draw() {
-	sys->draw();
-}
-
-void ParticleEmitter::update() {
-	float time = ofGetElapsedTimeMillis();
-
+// Spawn and update particles at the given simulation time, in seconds
+void ParticleEmitter::update(float time, float dt) {
 	// Check if emitter is active and that the period of time for next particle to spawn has passed.
-	if (active && ((time - lastSpawned) > (1000.0f / rate))) {
+	if (active && ((time - lastSpawned) > (1.0f / rate))) {
 		// Spawn a group of particles
 		for (int i = 0; i < groupSize; i++) {
 			spawnParticle(time);
@@ -37,7 +32,7 @@ void ParticleEmitter::update() {
 		}
 	}
 
-	sys->update();
+	sys->update(time, dt);
 }
 
 void ParticleEmitter::spawnParticle(float time) {
@@ -45,16 +40,16 @@ void ParticleEmitter::spawnParticle(float time) {
 
 	if (type == DiskEmitter) {
 		ofVec3f pos = ofVec3f(
-			ofRandom(position.x - radius, position.x + radius),
-			ofRandom(position.y + 0.20, position.y + 0.25),
-			ofRandom(position.z - radius, position.z + radius)
+			rng->range(position.x - radius, position.x + radius),
+			rng->range(position.y + 0.20, position.y + 0.25),
+			rng->range(position.z - radius, position.z + radius)
 		);
 		p.position.set(pos);
 		p.velocity = particleVelocity;
 	}
 	else if (type == RadialEmitter) {
 		ofVec3f dir = ofVec3f(
-			ofRandom(-1, 1), ofRandom(-1, 1), ofRandom(-1, 1)
+			rng->range(-1, 1), rng->range(-1, 1), rng->range(-1, 1)
 		);
 		p.velocity = dir.normalize() * particleVelocity.length();
 		p.position.set(position);
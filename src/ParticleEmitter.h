@@ -12,6 +12,7 @@ public:
 
 	ParticleSystem* sys;
 	EmitterType type;
+	SimRandom* rng = NULL;
 
 	ofVec3f position;
 	ofVec3f particleVelocity;
@@ -22,12 +23,11 @@ public:
 	float radius = 0.5f;
 	int groupSize = 20;
 	bool active = false;
-	int lastSpawned = 0;
+	float lastSpawned = 0;
 	bool oneShot = false;
 	bool fired = false;
 
 	void start();
 	void stop();
-	void draw();
-	void update();
+	void update(float time, float dt);
 };
\ No newline at end of file
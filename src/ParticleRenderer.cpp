@@ -0,0 +1,175 @@
+#include "ParticleRenderer.h"
+#include "Profiler.h"
+
+/* setup() loads the shaders and builds the static quad. Returns false if the
+ * shaders needed by the selected path could not be loaded. */
+bool ParticleRenderer::setup() {
+	// Instancing needs both the per-instance attributes and glDrawArraysInstanced
+	bInstanced = ofIsGLProgrammableRenderer() ||
+		(ofGLCheckExtension("GL_ARB_instanced_arrays") && ofGLCheckExtension("GL_ARB_draw_instanced"));
+
+#ifdef TARGET_OPENGLES
+	string shaderDir = "shaders_gles/";
+#else
+	string shaderDir = "shaders/";
+#endif
+
+	if (!pointShader.load(shaderDir + "shader")) {
+		cout << "Error: Can't load shader file: " << shaderDir << "shader not found" << endl;
+		return false;
+	}
+
+	if (!bInstanced) {
+		cout << "Instanced arrays not supported, drawing particles as point sprites" << endl;
+		return true;
+	}
+
+	if (!instancedShader.load(shaderDir + "particle")) {
+		cout << "Error: Can't load shader file: " << shaderDir << "particle not found" << endl;
+		return false;
+	}
+
+	// Triangle strip covering [-1, 1] x [-1, 1]; the shader scales it to the particle size
+	ofVec3f corners[4] = {
+		ofVec3f(-1, -1, 0), ofVec3f(1, -1, 0), ofVec3f(-1, 1, 0), ofVec3f(1, 1, 0)
+	};
+	quadVbo.setVertexData(corners, 4, GL_STATIC_DRAW);
+
+	return true;
+}
+
+// Start collecting particles for a new frame
+void ParticleRenderer::clear() {
+	instances.clear();
+}
+
+// Append the particles of a system, drawn size pixels wide, as of the given
+// simulation time
+void ParticleRenderer::add(const ParticleSystem& sys, float size, float time) {
+	gather(sys, size, time, instances);
+}
+
+// Append particles gathered earlier, possibly on another thread
+void ParticleRenderer::add(const vector<ParticleInstance>& more) {
+	instances.insert(instances.end(), more.begin(), more.end());
+}
+
+// Append the instance records of a system's particles to instancesRtn. Touches no
+// GL state, so it is safe to call off the main thread.
+void ParticleRenderer::gather(const ParticleSystem& sys, float size, float time, vector<ParticleInstance>& instancesRtn) {
+	for (int i = 0; i < sys.particles.size(); i++) {
+		const Particle& p = sys.particles[i];
+		float age = p.age(time);
+
+		ParticleInstance inst;
+		inst.x = p.position.x;
+		inst.y = p.position.y;
+		inst.z = p.position.z;
+		inst.size = size;
+		inst.life = p.lifespan > 0 ? ofClamp(age / p.lifespan, 0, 1) : 1;
+		instancesRtn.push_back(inst);
+	}
+}
+
+/* sortByDepth() orders the collected particles back to front along the camera's
+ * viewing direction, which alpha blending needs to composite correctly. */
+void ParticleRenderer::sortByDepth(const glm::vec3& camPosition, const glm::vec3& camForward) {
+	ProfileScope scope("particle sort");
+
+	int n = (int)instances.size();
+	depthKeys.resize(n);
+	order.resize(n);
+	for (int i = 0; i < n; i++) {
+		float depth = (instances[i].x - camPosition.x) * camForward.x +
+			(instances[i].y - camPosition.y) * camForward.y +
+			(instances[i].z - camPosition.z) * camForward.z;
+
+		// Invert the key so the farthest particle sorts first
+		depthKeys[i] = ~RadixSorter::floatToKey(depth);
+		order[i] = i;
+	}
+
+	sorter.sort(depthKeys, order, jobs);
+
+	sorted.resize(n);
+	for (int i = 0; i < n; i++) {
+		sorted[i] = instances[order[i]];
+	}
+	instances.swap(sorted);
+}
+
+// Upload the collected particles to the GPU
+void ParticleRenderer::upload() {
+	if (instances.size() == 0) {
+		return;
+	}
+
+	if (bInstanced) {
+		uploadInstances();
+	}
+	else {
+		uploadPoints();
+	}
+}
+
+void ParticleRenderer::uploadInstances() {
+	size_t bytes = instances.size() * sizeof(ParticleInstance);
+
+	// Grow the buffer geometrically; the attribute bindings only need
+	// refreshing when the storage is reallocated.
+	if (instances.size() > instanceCapacity) {
+		instanceCapacity = max(instances.size(), instanceCapacity * 2);
+		instanceBuffer.allocate(instanceCapacity * sizeof(ParticleInstance), GL_STREAM_DRAW);
+
+		int posSizeLoc = instancedShader.getAttributeLocation("instancePosSize");
+		int lifeLoc = instancedShader.getAttributeLocation("instanceLife");
+		quadVbo.setAttributeBuffer(posSizeLoc, instanceBuffer, 4, sizeof(ParticleInstance), 0);
+		quadVbo.setAttributeBuffer(lifeLoc, instanceBuffer, 1, sizeof(ParticleInstance), 4 * sizeof(float));
+		quadVbo.setAttributeDivisor(posSizeLoc, 1);
+		quadVbo.setAttributeDivisor(lifeLoc, 1);
+	}
+
+	instanceBuffer.updateData(0, bytes, instances.data());
+}
+
+void ParticleRenderer::uploadPoints() {
+	points.resize(instances.size());
+	sizes.resize(instances.size());
+	for (int i = 0; i < instances.size(); i++) {
+		points[i].set(instances[i].x, instances[i].y, instances[i].z);
+		sizes[i].set(instances[i].size, instances[i].life, 0);
+	}
+
+	int total = (int)points.size();
+	pointVbo.clear();
+	pointVbo.setVertexData(&points[0], total, GL_STATIC_DRAW);
+	pointVbo.setNormalData(&sizes[0], total, GL_STATIC_DRAW);
+}
+
+/* draw() renders the uploaded particles. Blending and depth state are left
+ * to the caller. */
+void ParticleRenderer::draw(const ofTexture& texture, const ofFloatColor& tint) {
+	if (instances.size() == 0) {
+		return;
+	}
+
+	if (bInstanced) {
+		instancedShader.begin();
+		instancedShader.setUniform2f("viewportSize", ofGetViewportWidth(), ofGetViewportHeight());
+		instancedShader.setUniform4f("tint", tint.r, tint.g, tint.b, tint.a);
+		texture.bind();
+		quadVbo.drawInstanced(GL_TRIANGLE_STRIP, 0, 4, (int)instances.size());
+		texture.unbind();
+		instancedShader.end();
+	}
+	else {
+		ofSetColor(tint);
+		ofEnablePointSprites();
+		pointShader.begin();
+		texture.bind();
+		pointVbo.draw(GL_POINTS, 0, (int)instances.size());
+		texture.unbind();
+		pointShader.end();
+		ofDisablePointSprites();
+	}
+}
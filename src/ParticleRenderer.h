@@ -0,0 +1,58 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ParticleSystem.h"
+#include "RadixSort.h"
+
+// Compact per-particle record uploaded to the GPU once per frame
+struct ParticleInstance {
+	float x, y, z;
+	float size;  // point size in pixels
+	float life;  // age / lifespan in [0, 1], the shader fades the color with it
+};
+
+// ParticleRenderer draws the particles of any number of systems as camera facing
+// quads with one instanced draw call. The quad corners live in a static vertex
+// buffer and everything per particle comes from a single instance buffer. When
+// the driver lacks instanced arrays it falls back to the original point sprites.
+class ParticleRenderer {
+private:
+	vector<ParticleInstance> instances;
+
+	// instanced path
+	ofVbo quadVbo;
+	ofBufferObject instanceBuffer;
+	size_t instanceCapacity = 0;
+	ofShader instancedShader;
+
+	// point sprite fallback
+	ofVbo pointVbo;
+	ofShader pointShader;
+	vector<ofVec3f> points;
+	vector<ofVec3f> sizes;
+
+	bool bInstanced = false;
+
+	// back-to-front ordering for alpha blending
+	RadixSorter sorter;
+	vector<uint32_t> depthKeys;
+	vector<uint32_t> order;
+	vector<ParticleInstance> sorted;
+
+	void uploadInstances();
+	void uploadPoints();
+public:
+	bool setup();
+	void clear();
+	void add(const ParticleSystem& sys, float size, float time);
+	void add(const vector<ParticleInstance>& more);
+	static void gather(const ParticleSystem& sys, float size, float time, vector<ParticleInstance>& instancesRtn);
+	void sortByDepth(const glm::vec3& camPosition, const glm::vec3& camForward);
+	void upload();
+	void draw(const ofTexture& texture, const ofFloatColor& tint);
+
+	int size() const { return (int)instances.size(); }
+	bool isInstanced() const { return bInstanced; }
+
+	JobSystem* jobs = NULL; // optional, to sort large batches in parallel
+};
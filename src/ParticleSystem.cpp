@@ -1,13 +1,17 @@
 #include "ParticleSystem.h"
 
-// add a particle to the system
+// add a particle to the system, dropping it if the system is full
 void ParticleSystem::add(const Particle& p) {
+	if (maxParticles > 0 && particles.size() >= maxParticles) {
+		return;
+	}
 	particles.push_back(p);
 }
 
-// add a force applied on the particles
-void ParticleSystem::addForce(Force* f) {
-	forces.push_back(f);
+// reserve storage for n particles up front
+void ParticleSystem::setCapacity(int n) {
+	maxParticles = n;
+	particles.reserve(n);
 }
 
 // remove a particle by index
@@ -15,44 +19,129 @@ void ParticleSystem::remove(int i) {
 	particles.erase(particles.begin() + i);
 }
 
-void ParticleSystem::update() {
+void ParticleSystem::update(float time, float dt) {
 	// If no particles, don't do anything
 	if (particles.size() == 0) {
 		return;
 	}
 
-	// Remove any particles that have exceeded their lifetime
-	vector<Particle>::iterator iter = particles.begin();
-	vector<Particle>::iterator tmp;
-	while (iter != particles.end()) {
-		if (iter->age() > iter->lifespan) {
-			tmp = particles.erase(iter);
-			iter = tmp;
+	// Remove any particles that have exceeded their lifetime, compacting the
+	// survivors in place
+	int alive = 0;
+	for (int i = 0; i < particles.size(); i++) {
+		if (particles[i].age(time) > particles[i].lifespan) {
+			continue;
 		}
-		else {
-			iter++;
+		if (alive != i) {
+			particles[alive] = particles[i];
 		}
+		alive++;
 	}
+	particles.resize(alive);
 
 	// apply forces on each particle
-	for (int i = 0; i < particles.size(); i++) {
-		for (int j = 0; j < forces.size(); j++) {
-			if (!forces[j]->applied) {
-				forces[j]->update(&particles[i]);
-			}
+	if (applyForcesKernel) {
+		applyForcesKernel(particles.data(), (int)particles.size());
+	}
+
+	if (repulsion > 0) {
+		applyRepulsion();
+	}
+
+	// integrate each particle
+	auto integrate = [this, dt](int begin, int end) {
+		for (int i = begin; i < end; i++) {
+			particles[i].integrate(dt);
 		}
+	};
+	if (jobs != NULL) {
+		jobs->parallelFor("particle integrate", (int)particles.size(), 512, integrate);
 	}
+	else {
+		integrate(0, (int)particles.size());
+	}
+
+	if (collisionType != NoCollision && terrain != NULL && !terrain->isEmpty()) {
+		collideTerrain();
+	}
+}
+
+/* applyRepulsion() pushes apart particles closer than repulsionRadius. The force
+ * falls off linearly to zero at the radius, and neighbors come from the spatial
+ * hash so the cost grows with local density rather than with n squared. Each
+ * particle only adds to its own forces, so the loop can be split up freely. */
+void ParticleSystem::applyRepulsion() {
+	neighborhood.build(particles, repulsionRadius, jobs);
 
-	for (int i = 0; i < forces.size(); i++) {
-		if (forces[i]->applyOnce) {
-			forces[i]->applied = true;
+	auto repel = [this](int begin, int end) {
+		static thread_local vector<int> neighbors;
+		for (int i = begin; i < end; i++) {
+			neighbors.clear();
+			neighborhood.queryRadius(particles[i].position, repulsionRadius, neighbors);
+
+			for (int j = 0; j < neighbors.size(); j++) {
+				if (neighbors[j] == i) continue;
+
+				ofVec3f d = particles[i].position - particles[neighbors[j]].position;
+				float dist = d.length();
+				if (dist == 0) continue;
+
+				particles[i].forces += d * (repulsion * (1.0f - dist / repulsionRadius) / dist);
+			}
 		}
+	};
+	if (jobs != NULL) {
+		jobs->parallelFor("particle repulsion", (int)particles.size(), 128, repel);
 	}
+	else {
+		repel(0, (int)particles.size());
+	}
+}
 
-	// integrate each particle
-	for (int i = 0; i < particles.size(); i++) {
-		particles[i].integrate();
+/* collideTerrain() looks up the ground height under every particle in a single
+ * batched heightfield query, then bounces or kills the particles below it. */
+void ParticleSystem::collideTerrain() {
+	int n = (int)particles.size();
+	xs.resize(n);
+	zs.resize(n);
+	groundHeights.resize(n);
+
+	for (int i = 0; i < n; i++) {
+		xs[i] = particles[i].position.x;
+		zs[i] = particles[i].position.z;
 	}
+
+	auto heights = [this](int begin, int end) {
+		terrain->heightsAt(&xs[begin], &zs[begin], end - begin, &groundHeights[begin]);
+	};
+	if (jobs != NULL) {
+		jobs->parallelFor("particle ground", n, 512, heights);
+	}
+	else {
+		heights(0, n);
+	}
+
+	int alive = 0;
+	for (int i = 0; i < n; i++) {
+		Particle& p = particles[i];
+		if (p.position.y < groundHeights[i]) {
+			if (collisionType == KillCollision) {
+				continue;
+			}
+
+			// Reflect off the ground plane, losing energy on impact
+			p.position.y = groundHeights[i];
+			if (p.velocity.y < 0) {
+				p.velocity.y = -p.velocity.y * restitution;
+			}
+		}
+
+		if (alive != i) {
+			particles[alive] = p;
+		}
+		alive++;
+	}
+	particles.resize(alive);
 }
 
 void ParticleSystem::setLifespan(float ls) {
@@ -60,10 +149,3 @@ void ParticleSystem::setLifespan(float ls) {
 		particles[i].lifespan = ls;
 	}
 }
-
-void ParticleSystem::draw() {
-	// draw each particle
-	for (int i = 0; i < particles.size(); i++) {
-		particles[i].draw();
-	}
-}
\ No newline at end of file
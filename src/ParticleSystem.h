@@ -3,16 +3,53 @@
 #include "ofMain.h"
 #include "Particle.h"
 #include "Force.h"
+#include "Heightfield.h"
+#include "SpatialHash.h"
+#include "JobSystem.h"
+
+typedef enum { NoCollision, BounceCollision, KillCollision } CollisionType;
 
 class ParticleSystem {
+private:
+	void collideTerrain();
+	void applyRepulsion();
+
+	// scratch buffers for the batched terrain query
+	vector<float> xs, zs, groundHeights;
 public:
 	vector<Particle> particles;
-	vector<Force*> forces;
+
+	// Forces on the particles, applied in one fused pass per update. The forces
+	// are owned by the caller and must outlive the system.
+	template <typename... Forces>
+	void setForces(Forces*... forces) {
+		applyForcesKernel = [forces...](Particle* particles, int count) {
+			applyForces(particles, count, *forces...);
+			int expand[] = { 0, (forces->endPass(), 0)... };
+			(void)expand;
+		};
+	}
+	function<void(Particle*, int)> applyForcesKernel;
+
+	// Particles are stored in place up to this many, so updates never allocate
+	int maxParticles = 0;
+	void setCapacity(int n);
+
+	// Optional terrain collision
+	Heightfield* terrain = NULL;
+	CollisionType collisionType = NoCollision;
+	float restitution = 0.3f;
+
+	// Optional particle-particle repulsion, resolved through a spatial hash
+	SpatialHash neighborhood;
+	float repulsion = 0;
+	float repulsionRadius = 0.5f;
+
+	// Optional, to spread the per-particle loops over its threads
+	JobSystem* jobs = NULL;
 
 	void add(const Particle&);
-	void addForce(Force*);
 	void remove(int);
-	void update();
+	void update(float time, float dt);
 	void setLifespan(float);
-	void draw();
-};
\ No newline at end of file
+};
@@ -13,5 +13,5 @@ public:
 	float radius = 1.0f;
 	ofVec3f forces;
 	ofVec3f tangentialForces;
-	virtual void integrate() = 0;
+	virtual void integrate(float dt) = 0;
 };
\ No newline at end of file
@@ -0,0 +1,33 @@
+#include "Profiler.h"
+
+Profiler& Profiler::get() {
+	static Profiler profiler;
+	return profiler;
+}
+
+// Blend a new measurement into the running average of the section
+void Profiler::record(const string& name, float ms) {
+	lock_guard<mutex> lock(sampleMutex);
+	map<string, float>::iterator it = samples.find(name);
+	if (it == samples.end()) {
+		samples[name] = ms;
+	}
+	else {
+		it->second = it->second * smoothing + ms * (1.0f - smoothing);
+	}
+}
+
+float Profiler::getMillis(const string& name) {
+	lock_guard<mutex> lock(sampleMutex);
+	map<string, float>::iterator it = samples.find(name);
+	return it == samples.end() ? 0 : it->second;
+}
+
+// Draw all sections as a list of "name: time" lines starting at (x, y)
+void Profiler::draw(float x, float y) {
+	lock_guard<mutex> lock(sampleMutex);
+	for (map<string, float>::iterator it = samples.begin(); it != samples.end(); it++) {
+		ofDrawBitmapString(it->first + ": " + ofToString(it->second, 3) + " ms", x, y);
+		y += 15;
+	}
+}
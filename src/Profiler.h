@@ -0,0 +1,31 @@
+#pragma once
+
+#include "ofMain.h"
+
+// Profiler keeps a smoothed timing, in milliseconds, for every named section of
+// the frame. Samples may be recorded from any thread.
+class Profiler {
+private:
+	mutex sampleMutex;
+	map<string, float> samples;
+public:
+	static Profiler& get();
+
+	void record(const string& name, float ms);
+	float getMillis(const string& name);
+	void draw(float x, float y);
+
+	float smoothing = 0.9f;
+};
+
+// ProfileScope records the time between its construction and destruction
+class ProfileScope {
+private:
+	string name;
+	uint64_t start;
+public:
+	ProfileScope(const string& name) : name(name), start(ofGetElapsedTimeMicros()) {}
+	~ProfileScope() {
+		Profiler::get().record(name, (ofGetElapsedTimeMicros() - start) / 1000.0f);
+	}
+};
@@ -0,0 +1,104 @@
+#include "RadixSort.h"
+#include "JobSystem.h"
+#include <cstring>
+#include <algorithm>
+
+using namespace std;
+
+uint32_t RadixSorter::floatToKey(float f) {
+	uint32_t u;
+	memcpy(&u, &f, sizeof(u));
+	// Negative floats: flip all bits. Positive floats: flip the sign bit.
+	uint32_t mask = (uint32_t)(-(int32_t)(u >> 31)) | 0x80000000u;
+	return u ^ mask;
+}
+
+void RadixSorter::countDigits(const uint32_t* keys, int begin, int end, int shift, int* digitCounts) {
+	for (int i = begin; i < end; i++) {
+		digitCounts[(keys[i] >> shift) & 0xff]++;
+	}
+}
+
+void RadixSorter::scatter(const uint32_t* keys, const uint32_t* values, uint32_t* keysOut, uint32_t* valuesOut,
+	int begin, int end, int shift, int* offsets)
+{
+	for (int i = begin; i < end; i++) {
+		int slot = offsets[(keys[i] >> shift) & 0xff]++;
+		keysOut[slot] = keys[i];
+		valuesOut[slot] = values[i];
+	}
+}
+
+/* sort() orders keys ascending and applies the same permutation to values. */
+void RadixSorter::sort(vector<uint32_t>& keys, vector<uint32_t>& values, JobSystem* jobs) {
+	int n = (int)keys.size();
+	if (n < 2) return;
+
+	// One chunk per thread; small inputs are not worth splitting up
+	int numChunks = jobs != NULL && n >= 16384 ? jobs->getNumThreads() + 1 : 1;
+
+	keyScratch.resize(n);
+	valueScratch.resize(n);
+	counts.resize(numChunks * 256);
+
+	uint32_t* keysIn = keys.data();
+	uint32_t* valuesIn = values.data();
+	uint32_t* keysOut = keyScratch.data();
+	uint32_t* valuesOut = valueScratch.data();
+
+	int chunk = (n + numChunks - 1) / numChunks;
+
+	for (int shift = 0; shift < 32; shift += 8) {
+		fill(counts.begin(), counts.end(), 0);
+
+		auto count = [&](int begin, int end) {
+			for (int t = begin; t < end; t++) {
+				countDigits(keysIn, min(t * chunk, n), min((t + 1) * chunk, n), shift, &counts[t * 256]);
+			}
+		};
+		if (numChunks > 1) {
+			jobs->parallelFor("radix count", numChunks, 1, count);
+		}
+		else {
+			count(0, 1);
+		}
+
+		// Exclusive prefix sum over (digit, chunk); skip the pass if every key
+		// shares the same digit
+		int offset = 0;
+		bool trivial = false;
+		for (int d = 0; d < 256; d++) {
+			int digitTotal = 0;
+			for (int t = 0; t < numChunks; t++) {
+				int c = counts[t * 256 + d];
+				counts[t * 256 + d] = offset;
+				offset += c;
+				digitTotal += c;
+			}
+			if (digitTotal == n) trivial = true;
+		}
+		if (trivial) continue;
+
+		auto place = [&](int begin, int end) {
+			for (int t = begin; t < end; t++) {
+				scatter(keysIn, valuesIn, keysOut, valuesOut, min(t * chunk, n), min((t + 1) * chunk, n),
+					shift, &counts[t * 256]);
+			}
+		};
+		if (numChunks > 1) {
+			jobs->parallelFor("radix scatter", numChunks, 1, place);
+		}
+		else {
+			place(0, 1);
+		}
+
+		swap(keysIn, keysOut);
+		swap(valuesIn, valuesOut);
+	}
+
+	// After an odd number of scatter passes the result lives in the scratch buffers
+	if (keysIn != keys.data()) {
+		memcpy(keys.data(), keysIn, n * sizeof(uint32_t));
+		memcpy(values.data(), valuesIn, n * sizeof(uint32_t));
+	}
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+class JobSystem;
+
+// RadixSorter sorts 32 bit keys together with a 32 bit payload using a stable
+// least-significant-digit radix sort with 8 bit digits. Each pass is split into
+// chunks that count and scatter independently, so large inputs are sorted on
+// the job system's threads. Scratch memory is kept between calls.
+class RadixSorter {
+private:
+	std::vector<uint32_t> keyScratch;
+	std::vector<uint32_t> valueScratch;
+	std::vector<int> counts;
+
+	void countDigits(const uint32_t* keys, int begin, int end, int shift, int* counts);
+	void scatter(const uint32_t* keys, const uint32_t* values, uint32_t* keysOut, uint32_t* valuesOut,
+		int begin, int end, int shift, int* offsets);
+public:
+	void sort(std::vector<uint32_t>& keys, std::vector<uint32_t>& values, JobSystem* jobs = NULL);
+
+	// Map a float to a key whose unsigned order matches the float order
+	static uint32_t floatToKey(float f);
+};
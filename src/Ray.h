@@ -11,30 +11,33 @@
  *      "An Efficient and Robust Ray-Box Intersection Algorithm"
  *      Journal of graphics tools, 10(1):49-54, 2005
  *
+ * Everything the test needs to know about the direction is worked out once,
+ * when the ray is made: its inverse, the sign of each component and, for rays
+ * along a coordinate axis like the straight down AGL ray, which axis. A zero
+ * component has an infinite inverse; Box::intersect() deals with the NaN that
+ * gives when the origin lies on a face of the box.
  */
 
 class Ray {
 public:
     Ray() { }
-    Ray(Vector3 o, Vector3 d) {
+    Ray(const Vector3& o, const Vector3& d) {
         origin = o;
         direction = d;
         inv_direction = Vector3(1 / d.x(), 1 / d.y(), 1 / d.z());
         sign[0] = (inv_direction.x() < 0);
         sign[1] = (inv_direction.y() < 0);
         sign[2] = (inv_direction.z() < 0);
-    }
-    Ray(const Ray& r) {
-        origin = r.origin;
-        direction = r.direction;
-        inv_direction = r.inv_direction;
-        sign[0] = r.sign[0]; sign[1] = r.sign[1]; sign[2] = r.sign[2];
+        if ((d.x() == 0) + (d.y() == 0) + (d.z() == 0) == 2) {
+            axis = d.x() != 0 ? 0 : (d.y() != 0 ? 1 : 2);
+        }
     }
 
     Vector3 origin;
     Vector3 direction;
     Vector3 inv_direction;
     int sign[3];
+    int axis = -1; // 0, 1 or 2 for a ray along that axis, else -1
 };
 
 #endif // _RAY_H_
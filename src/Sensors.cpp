@@ -0,0 +1,111 @@
+#include "Sensors.h"
+
+// Lay out the readings and point the lidar rays, relative to the lander's heading
+void SensorSuite::setup() {
+	lidarDirections.clear();
+	float tilt = glm::radians(lidarTilt);
+	for (int i = 0; i < numLidarRays; i++) {
+		float around = glm::radians(-lidarSpread / 2 + lidarSpread * (i + 0.5f) / numLidarRays);
+		lidarDirections.push_back(ofVec3f(sinf(around) * cosf(tilt), -sinf(tilt), cosf(around) * cosf(tilt)));
+	}
+
+	readings.assign(getNumReadings(), 0);
+	rays.resize(numLidarRays + 5);
+	distances.resize(numLidarRays + 5);
+	rayLevels.resize(numLidarRays + 5);
+}
+
+/* scan() reads every sensor for the lander's current state. */
+void SensorSuite::scan(const Simulation& sim, const Octree& octree) {
+	if (rays.size() != numLidarRays + 5) {
+		setup();
+	}
+	uint64_t start = ofGetElapsedTimeMicros();
+	levels = min(levels, octree.levels);
+
+	const LunarLander& lander = sim.lander;
+	const ofVec3f& p = lander.position;
+	Vector3 origin = p;
+
+	// The fan turns with the lander about the y axis, the way its thrusters do
+	float heading = glm::radians(lander.rotation);
+	float s = sinf(heading);
+	float c = cosf(heading);
+	for (int i = 0; i < numLidarRays; i++) {
+		const ofVec3f& d = lidarDirections[i];
+		rays[i] = Ray(origin, Vector3(d.x * c + d.z * s, d.y, d.z * c - d.x * s));
+	}
+
+	// Ground rays: below the lander, then either side of it along x and z
+	Vector3 down(0, -1, 0);
+	float h = slopeSpacing;
+	int g = numLidarRays;
+	rays[g] = Ray(origin, down);
+	rays[g + 1] = Ray(origin + Vector3(h, 0, 0), down);
+	rays[g + 2] = Ray(origin + Vector3(-h, 0, 0), down);
+	rays[g + 3] = Ray(origin + Vector3(0, 0, h), down);
+	rays[g + 4] = Ray(origin + Vector3(0, 0, -h), down);
+
+	// Lidar rays that read far last time may stop higher up the tree
+	for (int i = 0; i < rays.size(); i++) {
+		rayLevels[i] = levels;
+		if (i < numLidarRays) {
+			rayLevels[i] = min(levels, octree.getLevelsForTolerance(lidarTolerance * distances[i]));
+		}
+	}
+	octree.raycast(rays.data(), (int)rays.size(), range, distances.data(), rayLevels.data());
+
+	for (int i = 0; i < numLidarRays; i++) {
+		readings[getLidarOffset() + i] = distances[i];
+	}
+	readings[getAGLOffset()] = distances[g];
+
+	// Slope from the ground heights either side. Rays can slip between the points
+	// of the octree's leaves, so a side that found nothing is left out.
+	float ground[5];
+	bool bHit[5];
+	for (int i = 0; i < 5; i++) {
+		bHit[i] = distances[g + i] < range;
+		ground[i] = p.y - distances[g + i];
+	}
+	float dx = 0;
+	if (bHit[1] && bHit[2]) dx = (ground[1] - ground[2]) / (2 * h);
+	else if (bHit[0] && bHit[1]) dx = (ground[1] - ground[0]) / h;
+	else if (bHit[0] && bHit[2]) dx = (ground[0] - ground[2]) / h;
+	float dz = 0;
+	if (bHit[3] && bHit[4]) dz = (ground[3] - ground[4]) / (2 * h);
+	else if (bHit[0] && bHit[3]) dz = (ground[3] - ground[0]) / h;
+	else if (bHit[0] && bHit[4]) dz = (ground[0] - ground[4]) / h;
+	readings[getSlopeOffset()] = glm::degrees(atanf(sqrtf(dx * dx + dz * dz)));
+	readings[getSlopeOffset() + 1] = dx;
+	readings[getSlopeOffset() + 2] = dz;
+
+	for (int i = 0; i < 3; i++) {
+		ofVec3f offset = sim.landingAreas[i] - p;
+		float* area = &readings[getAreaOffset(i)];
+		area[0] = offset.x;
+		area[1] = offset.y;
+		area[2] = offset.z;
+		area[3] = offset.length();
+		area[4] = sim.areaLanded[i] ? 1.0f : 0.0f;
+	}
+
+	// Trade precision for time when over budget, and back when well under
+	lastMicros = (float)(ofGetElapsedTimeMicros() - start);
+	if (lastMicros > budgetMicros && levels > minLevels) {
+		levels--;
+	}
+	else if (lastMicros < budgetMicros / 2 && levels < octree.levels) {
+		levels++;
+	}
+	scannedTick = sim.tick;
+}
+
+// Where a ray of the last scan met the ground. Fails for rays that read range.
+bool SensorSuite::getHitPoint(int ray, ofVec3f& pointRtn) const {
+	if (ray >= distances.size() || distances[ray] >= range) return false;
+
+	Vector3 hit = rays[ray].origin + rays[ray].direction * distances[ray];
+	pointRtn.set(hit.x(), hit.y(), hit.z());
+	return true;
+}
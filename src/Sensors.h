@@ -0,0 +1,52 @@
+#pragma once
+
+#include "Simulation.h"
+
+/* SensorSuite is the lander's sensor package, read once per tick:
+ *  - a LIDAR fan of rays spread around the lander and tilted down,
+ *  - a ground ray straight down and four more around it for the slope below,
+ *  - where each landing area is relative to the lander.
+ * All of its rays go through the octree as one batched query, cast on the calling
+ * thread: a few dozen rays cost less than handing them to other threads would.
+ * The readings land in one flat buffer laid out as getLidarOffset() and friends
+ * describe.
+ *
+ * The scan keeps itself under budgetMicros. When a scan runs over, the next ones
+ * stop a level higher up the octree, which gives coarser (never longer) distances
+ * for less work; once scans are well under budget again they go back down.
+ * Lidar rays that read far last time stop earlier still: ground that far away
+ * only needs to be resolved to within lidarTolerance of its distance. */
+class SensorSuite {
+public:
+	int numLidarRays = 16;
+	float lidarSpread = 360; // degrees around the lander the fan covers, centered on forward
+	float lidarTilt = 30;    // degrees below horizontal
+	float range = 60;        // rays read range when they hit nothing
+	float slopeSpacing = 1.5f; // horizontal distance of the slope rays from the lander
+	float budgetMicros = 40;
+	int minLevels = 8; // coarsest octree depth the scan falls back to
+	float lidarTolerance = 0.02f; // node size a lidar ray may stop at, per unit of its last reading
+
+	void setup();
+	void scan(const Simulation& sim, const Octree& octree);
+
+	// Layout of readings
+	int getLidarOffset() const { return 0; }           // numLidarRays distances
+	int getAGLOffset() const { return numLidarRays; }  // ground distance straight down
+	int getSlopeOffset() const { return numLidarRays + 1; } // angle in degrees, dy/dx, dy/dz
+	int getAreaOffset(int i) const { return numLidarRays + 4 + i * 5; } // x, y, z relative to the lander, distance, landed
+	int getNumReadings() const { return numLidarRays + 4 + 3 * 5; }
+
+	bool getHitPoint(int ray, ofVec3f& pointRtn) const;
+
+	vector<float> readings;
+	vector<Ray> rays; // as cast by the last scan, lidar rays first
+	uint64_t scannedTick = UINT64_MAX; // sim.tick of the last scan
+	int levels = INT_MAX; // octree depth the last scan went down to
+	float lastMicros = 0;
+
+private:
+	vector<ofVec3f> lidarDirections; // relative to the lander's heading
+	vector<float> distances;
+	vector<int> rayLevels; // octree depth each ray may go down to
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Simulation.h"
+#include "ParticleRenderer.h"
+
+/* SimFrame is everything draw() needs from the simulation, copied out by the
+ * simulation thread after its ticks and handed over through a TripleBuffer, so
+ * that drawing never reads the live simulation. */
+struct SimFrame {
+	GameState state = LOADING;
+	uint64_t tick = 0;
+
+	ofVec3f landerPosition;
+	float landerRotation = 0; // degrees about y
+	ofVec3f landerForward;
+	Box landerHandle;         // the lander's bounds at half scale, dragged in PREGAME
+	vector<Box> collisionBoxes;
+	bool bThrusting = false;
+
+	float fuel = 0;
+	int score = 0;
+	bool shipExploded = false;
+	bool areaLanded[3] = { false, false, false };
+	int nearestArea = -1;
+	float agl = 0;
+
+	vector<ParticleInstance> particles;
+
+	// SensorSuite output of the last scan
+	vector<float> sensorReadings;
+	vector<Ray> sensorRays;
+	int sensorLevels = 0;
+	float sensorMicros = 0;
+
+	bool bAutopilot = false;
+	int autopilotTarget = -1;
+	bool bReplayDone = false;
+};
+
+// Requests from the main thread, run by the simulation thread before its next tick
+typedef enum {
+	SimStartFlight,
+	SimResetFlight,
+	SimRewind,      // value: 1 while BACKSPACE is held, 0 once released
+	SimToggleAutopilot,
+	SimRestartReplay,
+	SimReplaySpeed, // value: ticks per tick time
+	SimMoveLander   // offset: added to the lander's position in PREGAME
+} SimCommandType;
+
+struct SimCommand {
+	SimCommandType type;
+	float value;
+	ofVec3f offset;
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+
+// SimRandom is a small seedable generator (PCG32) for everything random in the
+// simulation. Unlike ofRandom every simulation owns its own sequence, and the
+// sequence is the same on every platform, so a flight can be replayed from its seed.
+class SimRandom {
+public:
+	SimRandom(uint64_t seed = 1) { setSeed(seed); }
+
+	void setSeed(uint64_t seed) {
+		state = 0;
+		inc = (seed << 1u) | 1u;
+		next();
+		state += seed;
+		next();
+	}
+
+	uint32_t next() {
+		uint64_t old = state;
+		state = old * 6364136223846793005ULL + inc;
+		uint32_t xorshifted = (uint32_t)(((old >> 18u) ^ old) >> 27u);
+		uint32_t rot = (uint32_t)(old >> 59u);
+		return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+	}
+
+	// Uniform float in [min, max)
+	float range(float min, float max) {
+		return min + (max - min) * ((next() >> 8) * (1.0f / 16777216.0f));
+	}
+
+	uint64_t state, inc;
+};
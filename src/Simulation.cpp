@@ -0,0 +1,457 @@
+#include "Simulation.h"
+#include "Util.h"
+
+Simulation::Simulation() :
+	thrustForce(ofVec3f(0, 0, 0)),
+	tanForce(ofVec3f(0, 0, 0)),
+	turbForce(turbulenceMin, turbulenceMax, &rng),
+	gravityForce(gravity),
+	particleForce(ofVec3f(0, -particleThrust, 0)),
+	particleTurbForce(turbulenceMin, turbulenceMax, &effectsRng),
+	explosionForce(explosionMagnitude, &effectsRng),
+	emitter(&particleSys),
+	explosionEmitter(&explosionParticleSys)
+{
+	// Set up particle system
+	emitter.rng = &effectsRng;
+	particleSys.setForces(&particleForce, &particleTurbForce, &gravityForce);
+	emitter.radius = 0.2f;
+	emitter.rate = 45.0f;
+	emitter.particleRadius = 3.0f;
+	emitter.lifespan = 0.5f;
+	emitter.groupSize = 50;
+	emitter.particleVelocity = ofVec3f(0, -0.8f, 0);
+
+	// Thrust exhaust splashes off the ground instead of sinking into it
+	particleSys.collisionType = BounceCollision;
+
+	// Let the exhaust spread out like a dust cloud
+	particleSys.repulsion = 4.0f;
+	particleSys.repulsionRadius = 0.5f;
+
+	// Set up explosion particle system
+	explosionEmitter.rng = &effectsRng;
+	explosionParticleSys.setForces(&explosionForce);
+
+	explosionEmitter.type = RadialEmitter;
+	explosionEmitter.particleRadius = 9.0f;
+	explosionEmitter.lifespan = 4.0f;
+	explosionEmitter.groupSize = 1300;
+	explosionEmitter.particleVelocity = ofVec3f(0, 0, 0);
+	explosionEmitter.oneShot = true;
+
+	explosionParticleSys.collisionType = BounceCollision;
+
+	// Room for a full explosion and a few seconds of exhaust, so particle updates
+	// and snapshots never reallocate
+	particleSys.setCapacity(maxParticles);
+	explosionParticleSys.setCapacity(maxParticles);
+
+	setEnvironment(MOON);
+	reset(1);
+}
+
+// Terrain the lander collides with. The streamer takes precedence over the octree when set.
+void Simulation::setTerrain(Octree* octree, Heightfield* heightfield, TerrainStreamer* streamer) {
+	this->octree = octree;
+	this->heightfield = heightfield;
+	this->streamer = streamer;
+	particleSys.terrain = heightfield;
+	explosionParticleSys.terrain = heightfield;
+}
+
+/* setJobs() spreads each tick over a job system: the stages of step() run as a
+ * graph and the particle loops fan out. The result is the same as without one.
+ * Simulations run by the batch tools leave it unset; they already fill every core
+ * with whole simulations. */
+void Simulation::setJobs(JobSystem* jobs) {
+	this->jobs = jobs;
+	particleSys.jobs = jobs;
+	explosionParticleSys.jobs = jobs;
+}
+
+// Place the landing areas for the given terrain
+void Simulation::setEnvironment(GameEnv env) {
+	if (env == DESERT) {
+		landingAreas[0] = ofVec3f(42.5, -0.9, 15.5);
+		landingAreas[1] = ofVec3f(28.2, 6.0, 81.7);
+		landingAreas[2] = ofVec3f(-106.7, 34.5, 29.7);
+	}
+	else {
+		landingAreas[0] = ofVec3f(30, 0.5, -30);      // Flat area
+		landingAreas[1] = ofVec3f(-132, 21.5, 36.3);  // Mountain area
+		landingAreas[2] = ofVec3f(-25, 10, 90.7);     // Inclined area
+	}
+}
+
+// Terrain model of the given environment, relative to the data folder
+string Simulation::getTerrainPath(GameEnv env) {
+	return env == DESERT ? "geo/terrain.fbx" : "geo/moon-houdini.obj";
+}
+
+// Hand the force settings to the forces
+void Simulation::applySettings() {
+	turbForce.setTurbulence(turbulenceMin, turbulenceMax);
+	particleTurbForce.setTurbulence(turbulenceMin, turbulenceMax);
+	gravityForce.setGravity(gravity);
+	particleForce.setThrust(ofVec3f(0, -particleThrust, 0));
+	explosionForce.setMagnitude(explosionMagnitude);
+}
+
+/* copySettings() makes this simulation run under the same settings and over the
+ * same terrain as another one, leaving its state alone. Together with restore()
+ * this gives a second simulation to try things out on. */
+void Simulation::copySettings(const Simulation& other) {
+	dt = other.dt;
+	for (int i = 0; i < 3; i++) {
+		landingAreas[i] = other.landingAreas[i];
+	}
+	startPosition = other.startPosition;
+	startFuel = other.startFuel;
+	landerMass = other.landerMass;
+	landerMin = other.landerMin;
+	landerMax = other.landerMax;
+	thrustMagnitude = other.thrustMagnitude;
+	torqueMagnitude = other.torqueMagnitude;
+	gravity = other.gravity;
+	turbulenceMin = other.turbulenceMin;
+	turbulenceMax = other.turbulenceMax;
+	particleThrust = other.particleThrust;
+	explosionMagnitude = other.explosionMagnitude;
+
+	octree = other.octree;
+	heightfield = other.heightfield;
+	streamer = other.streamer;
+	particleSys.terrain = other.particleSys.terrain;
+	explosionParticleSys.terrain = other.explosionParticleSys.terrain;
+
+	applySettings();
+}
+
+/* reset() puts the lander back at its start position with full fuel and applies
+ * the current settings. The game waits in PREGAME until start(). */
+void Simulation::reset(uint64_t seed) {
+	rng.setSeed(seed);
+	effectsRng.setSeed(seed ^ 0x9e3779b97f4a7c15ULL);
+
+	state = PREGAME;
+	tick = 0;
+	time = 0;
+	events = 0;
+	bThrusting = false;
+
+	lander = LunarLander();
+	lander.sceneMin = landerMin;
+	lander.sceneMax = landerMax;
+	lander.setPosition(startPosition);
+	lander.mass = landerMass;
+	impactSpeed = 0;
+
+	fuel = startFuel;
+	score = 0;
+	shipExploded = false;
+	for (int i = 0; i < 3; i++) {
+		areaLanded[i] = false;
+	}
+
+	thrustForce.setThrust(ofVec3f(0, 0, 0));
+	tanForce.setTorque(ofVec3f(0, 0, 0));
+	applySettings();
+
+	emitter.stop();
+	emitter.lastSpawned = 0;
+	explosionEmitter.stop();
+	explosionEmitter.lastSpawned = 0;
+	particleSys.particles.clear();
+	explosionParticleSys.particles.clear();
+	collisionBoxes.clear();
+}
+
+/* start() begins the flight from wherever the lander was placed. The generators
+ * are reseeded so the flight depends on the seed alone, not on how long the game
+ * sat in PREGAME. */
+void Simulation::start(uint64_t seed) {
+	rng.setSeed(seed);
+	effectsRng.setSeed(seed ^ 0x9e3779b97f4a7c15ULL);
+	state = INGAME;
+}
+
+// Set the thruster forces from the input bits
+void Simulation::applyInput(uint32_t input) {
+	// Apply rotational forces
+	ofVec3f torque = ofVec3f(0, 0, 0);
+	if (input & INPUT_ROTATE_LEFT) {
+		torque += ofVec3f(0, -torqueMagnitude, 0);
+	}
+	if (input & INPUT_ROTATE_RIGHT) {
+		torque += ofVec3f(0, torqueMagnitude, 0);
+	}
+	tanForce.setTorque(torque);
+
+	// Apply directional (thruster) forces
+	ofVec3f thrust = ofVec3f(0, 0, 0);
+	if (input & INPUT_THRUST_UP) {
+		thrust += ofVec3f(0, thrustMagnitude, 0);
+	}
+	if (input & INPUT_THRUST_DOWN) {
+		thrust += ofVec3f(0, -thrustMagnitude, 0);
+	}
+	if (input & INPUT_FORWARD) {
+		thrust += thrustMagnitude * lander.getForwardUV();
+	}
+	if (input & INPUT_BACKWARD) {
+		thrust += thrustMagnitude * lander.getBackwardUV();
+	}
+	if (input & INPUT_LEFT) {
+		thrust += thrustMagnitude * lander.getLeftUV();
+	}
+	if (input & INPUT_RIGHT) {
+		thrust += thrustMagnitude * lander.getRightUV();
+	}
+	thrustForce.setThrust(thrust);
+}
+
+/* step() advances the game by one tick of dt seconds. */
+void Simulation::step(uint32_t input) {
+	events = 0;
+
+	if (score == 30) {
+		state = ENDGAME;
+	}
+
+	applyInput(input);
+	bThrusting = false;
+
+	if (jobs == NULL) {
+		stepLander();
+		stepEffects();
+		getCollisionBoxes(lander.getBounds(), collisionBoxes);
+		collide();
+		return;
+	}
+
+	// The particle effects and the terrain query only read the lander, so once it
+	// has moved they run side by side
+	JobId landerJob = jobs->add("lander", [this] { stepLander(); });
+	JobId effectsJob = jobs->add("effects", [this] { stepEffects(); }, { landerJob });
+	JobId queryJob = jobs->add("collision query", [this] { getCollisionBoxes(lander.getBounds(), collisionBoxes); }, { landerJob });
+	jobs->add("collision", [this] { collide(); }, { effectsJob, queryJob });
+	jobs->run();
+}
+
+// Apply the forces on the lander and move it, then advance the clock
+void Simulation::stepLander() {
+	if (state == INGAME) {
+		thrustForce.apply(lander);
+		tanForce.apply(lander);
+
+		if (fuel <= 0) {
+			state = ENDGAME;
+		}
+		else if (thrustForce.getThrust().length() != 0 || tanForce.getTorque().length() != 0) {
+			// Reduce fuel if thrusters are being used
+			fuel -= dt;
+			bThrusting = true;
+		}
+	}
+	if (state != PREGAME) {
+		turbForce.apply(lander);
+		gravityForce.apply(lander);
+		lander.integrate(dt);
+	}
+
+	tick++;
+	time += dt;
+}
+
+// Move the exhaust along with the lander and advance both particle effects
+void Simulation::stepEffects() {
+	if (!bEffects) return;
+
+	if (bThrusting) emitter.start();
+	else emitter.stop();
+
+	emitter.position = lander.getPosition();
+	emitter.update((float)time, dt);
+	explosionEmitter.update((float)time, dt);
+}
+
+static void saveEmitter(const ParticleEmitter& emitter, EmitterSnapshot& snapshot) {
+	snapshot.position = emitter.position;
+	snapshot.active = emitter.active;
+	snapshot.fired = emitter.fired;
+	snapshot.lastSpawned = emitter.lastSpawned;
+}
+
+static void restoreEmitter(ParticleEmitter& emitter, const EmitterSnapshot& snapshot) {
+	emitter.position = snapshot.position;
+	emitter.active = snapshot.active;
+	emitter.fired = snapshot.fired;
+	emitter.lastSpawned = snapshot.lastSpawned;
+}
+
+// Copy particles into storage reserved up front, keeping as many as fit
+static void copyParticles(const vector<Particle>& from, vector<Particle>& to) {
+	size_t n = min(from.size(), to.capacity());
+	to.assign(from.begin(), from.begin() + n);
+}
+
+/* save() copies the state into a snapshot without allocating. Particle effects
+ * are only saved when the snapshot has room reserved for them. */
+void Simulation::save(SimSnapshot& snapshot) const {
+	snapshot.tick = tick;
+	snapshot.time = time;
+	snapshot.rng = rng;
+	snapshot.effectsRng = effectsRng;
+
+	snapshot.state = state;
+	snapshot.lander = lander;
+	snapshot.fuel = fuel;
+	snapshot.score = score;
+	snapshot.shipExploded = shipExploded;
+	for (int i = 0; i < 3; i++) {
+		snapshot.areaLanded[i] = areaLanded[i];
+	}
+	snapshot.events = events;
+	snapshot.impactSpeed = impactSpeed;
+	snapshot.bThrusting = bThrusting;
+
+	snapshot.thrust = thrustForce.getThrust();
+	snapshot.torque = tanForce.getTorque();
+	snapshot.explosionApplied = explosionForce.applied;
+
+	saveEmitter(emitter, snapshot.emitter);
+	saveEmitter(explosionEmitter, snapshot.explosionEmitter);
+	if (snapshot.hasEffects()) {
+		copyParticles(particleSys.particles, snapshot.particles);
+		copyParticles(explosionParticleSys.particles, snapshot.explosionParticles);
+	}
+}
+
+/* restore() puts the simulation back into the snapshot's state. The settings and
+ * terrain are not part of a snapshot and stay as they are. */
+void Simulation::restore(const SimSnapshot& snapshot) {
+	tick = snapshot.tick;
+	time = snapshot.time;
+	rng = snapshot.rng;
+	effectsRng = snapshot.effectsRng;
+
+	state = (GameState)snapshot.state;
+	lander = snapshot.lander;
+	fuel = snapshot.fuel;
+	score = snapshot.score;
+	shipExploded = snapshot.shipExploded;
+	for (int i = 0; i < 3; i++) {
+		areaLanded[i] = snapshot.areaLanded[i];
+	}
+	events = snapshot.events;
+	impactSpeed = snapshot.impactSpeed;
+	bThrusting = snapshot.bThrusting;
+
+	thrustForce.setThrust(snapshot.thrust);
+	tanForce.setTorque(snapshot.torque);
+	explosionForce.applied = snapshot.explosionApplied;
+
+	restoreEmitter(emitter, snapshot.emitter);
+	restoreEmitter(explosionEmitter, snapshot.explosionEmitter);
+	if (snapshot.hasEffects()) {
+		copyParticles(snapshot.particles, particleSys.particles);
+		copyParticles(snapshot.explosionParticles, explosionParticleSys.particles);
+	}
+}
+
+// Handle lander collision with the terrain boxes found around it
+void Simulation::collide() {
+	Box bounds = lander.getBounds();
+
+	if (state == PREGAME || collisionBoxes.size() < 10) {
+		return;
+	}
+
+	if (state == INGAME) {
+		impactSpeed = lander.velocity.length();
+		events |= EVENT_TOUCHDOWN;
+	}
+
+	// Apply impulse to the lander upon collision
+	ofVec3f yNormal = ofVec3f(0, 1, 0);
+	lander.velocity = (yNormal.dot(-lander.velocity) * yNormal) * 1.25;
+
+	if (state != INGAME) {
+		return;
+	}
+
+	// Explode if lander is too fast
+	if (lander.velocity.length() >= 2.5f) {
+		explosionForce.arm();
+		explosionEmitter.position = lander.getPosition();
+		explosionEmitter.start();
+		shipExploded = true;
+		events |= EVENT_EXPLODED;
+		state = ENDGAME;
+	}
+
+	// Check if lander successfully landed on one of the landing areas
+	if (lander.velocity.length() < 1.5f) {
+		for (int i = 0; i < 3; i++) {
+			if (!areaLanded[i] && bounds.inside(landingAreas[i])) {
+				areaLanded[i] = true;
+				score += 10;
+				events |= EVENT_LANDED;
+				break;
+			}
+		}
+	}
+}
+
+// Height of the lander above the ground straight below it, from the heightfield,
+// or from the tile below the lander when the terrain is streamed
+float Simulation::getAGL() const {
+	if (heightfield == NULL || heightfield->isEmpty()) {
+		const ofVec3f& p = lander.position;
+		glm::vec3 ground;
+		if (streamer != NULL && streamer->intersect(Ray(Vector3(p.x, p.y, p.z), Vector3(0, -1, 0)), ground)) {
+			return p.y - ground.y;
+		}
+		return lander.position.y;
+	}
+	return lander.position.y - heightfield->heightAt(lander.position.x, lander.position.z);
+}
+
+// Nearest landing area that has not been landed on yet, -1 once all have
+int Simulation::getNearestArea() const {
+	int nearest = -1;
+	float nearestDistance = 0;
+	for (int i = 0; i < 3; i++) {
+		if (areaLanded[i]) continue;
+		float d = lander.position.distance(landingAreas[i]);
+		if (nearest < 0 || d < nearestDistance) {
+			nearest = i;
+			nearestDistance = d;
+		}
+	}
+	return nearest;
+}
+
+// Collect the terrain leaf boxes that overlap the given bounds
+void Simulation::getCollisionBoxes(const Box& bounds, vector<Box>& boxListRtn) {
+	boxListRtn.clear();
+	if (streamer != NULL) {
+		streamer->intersect(bounds, boxListRtn);
+	}
+	else if (octree != NULL) {
+		octree->intersect(bounds, octree->root, boxListRtn);
+	}
+}
+
+// Load the terrain mesh and build the octree and heightfield over it
+bool SimTerrain::load(const string& meshPackPath) {
+	vector<MeshPart> parts;
+	if (!loadMeshPack(meshPackPath, mesh, parts)) {
+		cout << "Error: Can't load mesh " << meshPackPath << endl;
+		return false;
+	}
+	octree.create(mesh, 20);
+	heightfield.create(octree, 0.5f);
+	return true;
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include "ofMain.h"
+#include "LunarLander.h"
+#include "Force.h"
+#include "ParticleEmitter.h"
+#include "Octree.h"
+#include "Heightfield.h"
+#include "TerrainTiles.h"
+#include "SimRandom.h"
+#include "Snapshot.h"
+#include "JobSystem.h"
+
+// State of the game
+enum GameState {
+	LOADING, PREGAME, INGAME, ENDGAME
+};
+
+// Decide which models to load
+enum GameEnv {
+	MOON, DESERT
+};
+
+// Flight controls, one bit each, sampled once per tick
+enum {
+	INPUT_THRUST_UP = 1 << 0,    // w
+	INPUT_THRUST_DOWN = 1 << 1,  // s
+	INPUT_ROTATE_LEFT = 1 << 2,  // a
+	INPUT_ROTATE_RIGHT = 1 << 3, // d
+	INPUT_FORWARD = 1 << 4,      // arrow keys
+	INPUT_BACKWARD = 1 << 5,
+	INPUT_LEFT = 1 << 6,
+	INPUT_RIGHT = 1 << 7
+};
+
+// Things that happened during a tick, for the app to answer with sound and light
+enum {
+	EVENT_LANDED = 1 << 0,
+	EVENT_EXPLODED = 1 << 1,
+	EVENT_TOUCHDOWN = 1 << 2 // lander hit the ground during the game, see impactSpeed
+};
+
+// Simulation is the game without the window: the lander, its forces, the particle
+// effects, fuel, score and landing rules, advanced in fixed ticks from one input
+// word per tick. Everything random draws from generators seeded per flight, so
+// the same seed and inputs always produce the same flight.
+class Simulation {
+public:
+	Simulation();
+
+	// Forces and emitters point at each other inside the simulation
+	Simulation(const Simulation&) = delete;
+	Simulation& operator=(const Simulation&) = delete;
+
+	void setTerrain(Octree* octree, Heightfield* heightfield, TerrainStreamer* streamer = NULL);
+	void setJobs(JobSystem* jobs);
+	void setEnvironment(GameEnv env);
+	static string getTerrainPath(GameEnv env);
+	void copySettings(const Simulation& other);
+	void reset(uint64_t seed);
+	void start(uint64_t seed);
+	void step(uint32_t input);
+
+	void getCollisionBoxes(const Box& bounds, vector<Box>& boxListRtn);
+	bool isThrusting() const { return bThrusting; }
+	float getAGL() const;
+	int getNearestArea() const;
+
+	// Save and restore the complete state, for rewinding and what-if rollouts
+	void save(SimSnapshot& snapshot) const;
+	void restore(const SimSnapshot& snapshot);
+
+	// Fixed time step, in seconds
+	float dt = 1.0f / 60.0f;
+	uint64_t tick = 0;
+	double time = 0;
+
+	// Lander forces draw from rng, particle effects from effectsRng so that
+	// effects can be turned off without changing the flight
+	SimRandom rng;
+	SimRandom effectsRng;
+	bool bEffects = true;
+
+	GameState state = PREGAME;
+	LunarLander lander;
+	float fuel = 120;
+	int score = 0;
+	bool shipExploded = false;
+	uint32_t events = 0; // EVENT_* bits raised by the last tick
+	float impactSpeed = 0; // speed of the last touchdown
+
+	ofVec3f landingAreas[3]; // see setEnvironment()
+	bool areaLanded[3] = { false, false, false };
+
+	// Settings, applied on reset()
+	ofVec3f startPosition = ofVec3f(0, 15.0f, 0);
+	float startFuel = 120;
+	float landerMass = 10.0f;
+
+	// Extent of the lander relative to its position. The app sets it from the
+	// loaded model; the default is roughly the size of the bundled landers.
+	ofVec3f landerMin = ofVec3f(-2.0f, 0, -2.0f);
+	ofVec3f landerMax = ofVec3f(2.0f, 3.0f, 2.0f);
+	float thrustMagnitude = 90.0f;
+	float torqueMagnitude = 6000.0f;
+	float gravity = 1.64f;
+	ofVec3f turbulenceMin = ofVec3f(-2.0f, -2.0f, -2.0f);
+	ofVec3f turbulenceMax = ofVec3f(2.0f, 2.0f, 2.0f);
+	float particleThrust = 35.0f;
+	float explosionMagnitude = 1400.0f;
+	const int maxParticles = 2048; // per particle system
+
+	// Forces
+	ThrustForce thrustForce;
+	TangentialForce tanForce;
+	TurbulenceForce turbForce;
+	GravityForce gravityForce;
+	ThrustForce particleForce;
+	TurbulenceForce particleTurbForce;
+	ImpulseRadialForce explosionForce;
+
+	// Particles
+	ParticleSystem particleSys;
+	ParticleEmitter emitter;
+	ParticleSystem explosionParticleSys;
+	ParticleEmitter explosionEmitter;
+
+	// Terrain boxes touching the lander, from the last tick
+	vector<Box> collisionBoxes;
+
+private:
+	void applySettings();
+	void applyInput(uint32_t input);
+	void stepLander();
+	void stepEffects();
+	void collide();
+
+	Octree* octree = NULL;
+	Heightfield* heightfield = NULL;
+	TerrainStreamer* streamer = NULL;
+	JobSystem* jobs = NULL;
+	bool bThrusting = false;
+};
+
+// Terrain for simulations that run without a window, loaded from a MeshPack
+// baked by tools/meshpack
+class SimTerrain {
+public:
+	bool load(const string& meshPackPath);
+
+	ofMesh mesh; // the octree references its vertices
+	Octree octree;
+	Heightfield heightfield;
+};
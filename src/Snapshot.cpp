@@ -0,0 +1,43 @@
+#include "Snapshot.h"
+
+// Allocate every slot, including room for maxParticles particles per system
+void SnapshotRing::setup(int capacity, int maxParticles) {
+	slots.clear();
+	slots.resize(capacity);
+	for (int i = 0; i < capacity; i++) {
+		slots[i].reserve(maxParticles);
+	}
+	clear();
+}
+
+// Slot for the next snapshot
+SimSnapshot& SnapshotRing::push() {
+	if (count < slots.size()) {
+		count++;
+	}
+	else {
+		first = (first + 1) % slots.size();
+	}
+	return slots[(first + count - 1) % slots.size()];
+}
+
+// Drop the newest snapshot
+void SnapshotRing::pop() {
+	if (count > 0) count--;
+}
+
+// Snapshot taken at the given tick, if it is still in the ring
+const SimSnapshot* SnapshotRing::find(uint64_t tick) const {
+	if (count == 0 || tick < at(0).tick || tick > back().tick) {
+		return NULL;
+	}
+	// One snapshot per tick unless ticks were skipped, so start with a direct guess
+	int i = (int)(tick - at(0).tick);
+	if (i < count && at(i).tick == tick) {
+		return &at(i);
+	}
+	for (int j = 0; j < count; j++) {
+		if (at(j).tick == tick) return &at(j);
+	}
+	return NULL;
+}
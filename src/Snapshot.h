@@ -0,0 +1,72 @@
+#pragma once
+
+#include "ofMain.h"
+#include "LunarLander.h"
+#include "Particle.h"
+#include "SimRandom.h"
+
+// Emitter state that changes while the game runs
+struct EmitterSnapshot {
+	ofVec3f position;
+	bool active;
+	bool fired;
+	float lastSpawned;
+};
+
+// SimSnapshot is everything a Simulation needs to continue from a given tick.
+// The particle arrays are sized once by reserve() and filled up to that size, so
+// taking and restoring snapshots never allocates. A snapshot reserved for zero
+// particles leaves the particle effects out.
+struct SimSnapshot {
+	uint64_t tick;
+	double time;
+	SimRandom rng;
+	SimRandom effectsRng;
+
+	int state;
+	LunarLander lander;
+	float fuel;
+	int score;
+	bool shipExploded;
+	bool areaLanded[3];
+	uint32_t events;
+	float impactSpeed;
+	bool bThrusting;
+
+	ofVec3f thrust;
+	ofVec3f torque;
+	bool explosionApplied;
+
+	EmitterSnapshot emitter;
+	EmitterSnapshot explosionEmitter;
+	vector<Particle> particles;
+	vector<Particle> explosionParticles;
+
+	void reserve(int maxParticles) {
+		particles.reserve(maxParticles);
+		explosionParticles.reserve(maxParticles);
+	}
+	bool hasEffects() const { return particles.capacity() > 0; }
+};
+
+// SnapshotRing keeps the most recent snapshots, one slot per tick, in storage
+// allocated up front. When full, taking a new snapshot overwrites the oldest.
+class SnapshotRing {
+public:
+	void setup(int capacity, int maxParticles = 0);
+	void clear() { first = 0; count = 0; }
+
+	SimSnapshot& push();
+	void pop();
+
+	int size() const { return count; }
+	bool isEmpty() const { return count == 0; }
+	const SimSnapshot& at(int i) const { return slots[(first + i) % slots.size()]; } // 0 is the oldest
+	const SimSnapshot& back() const { return at(count - 1); }
+	const SimSnapshot* find(uint64_t tick) const;
+
+private:
+	vector<SimSnapshot> slots;
+	int first = 0;
+	int count = 0;
+};
@@ -0,0 +1,146 @@
+#include "SpatialHash.h"
+
+// Buckets are hashed from integer cell coordinates with the usual large primes
+unsigned int SpatialHash::bucketOf(int cx, int cy, int cz) const {
+	unsigned int h = (unsigned int)cx * 73856093u ^ (unsigned int)cy * 19349663u ^ (unsigned int)cz * 83492791u;
+	return h & bucketMask;
+}
+
+/* build() sorts the particles into buckets. The work is split into contiguous
+ * chunks: every chunk counts its own histogram, the histograms are combined into
+ * per chunk write offsets, and every chunk then scatters its particles without
+ * touching another chunk's slots, so the chunks can run on the job system's threads. */
+void SpatialHash::build(const vector<Particle>& particles, float size, JobSystem* jobs) {
+	int n = (int)particles.size();
+	cellSize = size;
+
+	// Use a power of two bucket count of about twice the particle count
+	unsigned int numBuckets = 64;
+	while (numBuckets < 2 * (unsigned int)n) numBuckets <<= 1;
+	bucketMask = numBuckets - 1;
+
+	px.resize(n);
+	py.resize(n);
+	pz.resize(n);
+	for (int i = 0; i < n; i++) {
+		px[i] = particles[i].position.x;
+		py[i] = particles[i].position.y;
+		pz[i] = particles[i].position.z;
+	}
+
+	buckets.resize(n);
+	sortedIndices.resize(n);
+	sx.resize(n);
+	sy.resize(n);
+	sz.resize(n);
+
+	// One chunk per thread; small systems are not worth splitting up
+	int numChunks = jobs != NULL && n >= 8192 ? jobs->getNumThreads() + 1 : 1;
+	int chunk = (n + numChunks - 1) / numChunks;
+	chunkCounts.assign(numChunks * numBuckets, 0);
+
+	auto count = [&](int begin, int end) {
+		for (int t = begin; t < end; t++) {
+			computeBuckets(min(t * chunk, n), min((t + 1) * chunk, n), &chunkCounts[t * numBuckets]);
+		}
+	};
+	if (numChunks > 1) {
+		jobs->parallelFor("hash count", numChunks, 1, count);
+	}
+	else {
+		count(0, 1);
+	}
+
+	// Exclusive prefix sum over (bucket, chunk) turns the counts into write offsets
+	cellStart.resize(numBuckets + 1);
+	int offset = 0;
+	for (unsigned int b = 0; b < numBuckets; b++) {
+		cellStart[b] = offset;
+		for (int t = 0; t < numChunks; t++) {
+			int c = chunkCounts[t * numBuckets + b];
+			chunkCounts[t * numBuckets + b] = offset;
+			offset += c;
+		}
+	}
+	cellStart[numBuckets] = offset;
+
+	auto place = [&](int begin, int end) {
+		for (int t = begin; t < end; t++) {
+			scatter(min(t * chunk, n), min((t + 1) * chunk, n), &chunkCounts[t * numBuckets]);
+		}
+	};
+	if (numChunks > 1) {
+		jobs->parallelFor("hash scatter", numChunks, 1, place);
+	}
+	else {
+		place(0, 1);
+	}
+}
+
+void SpatialHash::computeBuckets(int begin, int end, int* counts) {
+	float invCell = 1.0f / cellSize;
+	for (int i = begin; i < end; i++) {
+		unsigned int b = bucketOf((int)floorf(px[i] * invCell), (int)floorf(py[i] * invCell),
+			(int)floorf(pz[i] * invCell));
+		buckets[i] = b;
+		counts[b]++;
+	}
+}
+
+void SpatialHash::scatter(int begin, int end, int* offsets) {
+	for (int i = begin; i < end; i++) {
+		int slot = offsets[buckets[i]]++;
+		sortedIndices[slot] = i;
+		sx[slot] = px[i];
+		sy[slot] = py[i];
+		sz[slot] = pz[i];
+	}
+}
+
+/* queryRadius() appends the indices of all particles within radius of p and returns
+ * how many were found. radius must not exceed the cell size, so at most 27 cells are
+ * visited. It only reads the hash, so any number of threads may query concurrently
+ * once build() has returned. */
+int SpatialHash::queryRadius(const ofVec3f& p, float radius, vector<int>& neighborsRtn) const {
+	if (cellStart.size() == 0) return 0;
+
+	float invCell = 1.0f / cellSize;
+	int x0 = (int)floorf((p.x - radius) * invCell), x1 = (int)floorf((p.x + radius) * invCell);
+	int y0 = (int)floorf((p.y - radius) * invCell), y1 = (int)floorf((p.y + radius) * invCell);
+	int z0 = (int)floorf((p.z - radius) * invCell), z1 = (int)floorf((p.z + radius) * invCell);
+
+	// Different cells can hash to the same bucket; visit each bucket only once
+	unsigned int visited[27];
+	int numVisited = 0;
+
+	float r2 = radius * radius;
+	int found = 0;
+	for (int cz = z0; cz <= z1; cz++) {
+		for (int cy = y0; cy <= y1; cy++) {
+			for (int cx = x0; cx <= x1; cx++) {
+				unsigned int b = bucketOf(cx, cy, cz);
+
+				bool seen = false;
+				for (int i = 0; i < numVisited; i++) {
+					if (visited[i] == b) {
+						seen = true;
+						break;
+					}
+				}
+				if (seen) continue;
+				if (numVisited < 27) visited[numVisited++] = b;
+
+				for (int s = cellStart[b]; s < cellStart[b + 1]; s++) {
+					float dx = sx[s] - p.x;
+					float dy = sy[s] - p.y;
+					float dz = sz[s] - p.z;
+					if (dx * dx + dy * dy + dz * dz <= r2) {
+						neighborsRtn.push_back(sortedIndices[s]);
+						found++;
+					}
+				}
+			}
+		}
+	}
+	return found;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "ofMain.h"
+#include "Particle.h"
+#include "JobSystem.h"
+
+// SpatialHash buckets particles into a uniform grid of cells so that radius
+// neighbor queries only look at nearby particles instead of the whole system.
+// It is rebuilt from scratch every frame with a counting sort, which leaves the
+// particles of each bucket contiguous in the sorted position arrays.
+class SpatialHash {
+public:
+	void build(const vector<Particle>& particles, float cellSize, JobSystem* jobs = NULL);
+	int queryRadius(const ofVec3f& p, float radius, vector<int>& neighborsRtn) const;
+
+	float cellSize = 1.0f;
+	unsigned int bucketMask = 0;
+
+	// Particle positions (structure of arrays) in particle order
+	vector<float> px, py, pz;
+
+	// Particles sorted by bucket: bucket b owns the range [cellStart[b], cellStart[b + 1])
+	vector<int> cellStart;
+	vector<int> sortedIndices;
+	vector<float> sx, sy, sz;
+
+private:
+	unsigned int bucketOf(int cx, int cy, int cz) const;
+	void computeBuckets(int begin, int end, int* counts);
+	void scatter(int begin, int end, int* offsets);
+
+	vector<unsigned int> buckets;
+
+	// Per chunk bucket counts, then write offsets; kept between builds so the
+	// storage is only reallocated when the system grows
+	vector<int> chunkCounts;
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/*
+ * SpscRing is a fixed size, lock-free queue for exactly one producer thread and
+ * one consumer thread. push() and pop() never wait: push() fails when the ring is
+ * full, pop() when it is empty. The two indices only ever grow and sit on their
+ * own cache lines, so the producer and consumer don't contend over one line.
+ */
+template <typename T>
+class SpscRing {
+private:
+	std::vector<T> items;
+	size_t mask = 0;
+	alignas(64) std::atomic<size_t> head{ 0 }; // next slot to write, owned by the producer
+	alignas(64) std::atomic<size_t> tail{ 0 }; // next slot to read, owned by the consumer
+public:
+	// Capacity is rounded up to a power of two. Not thread safe: call before use.
+	void setup(size_t capacity) {
+		size_t size = 1;
+		while (size < capacity) size <<= 1;
+		items.assign(size, T());
+		mask = size - 1;
+		head = 0;
+		tail = 0;
+	}
+
+	bool push(const T& item) {
+		size_t h = head.load(std::memory_order_relaxed);
+		if (h - tail.load(std::memory_order_acquire) == items.size()) return false;
+		items[h & mask] = item;
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool pop(T& item) {
+		size_t t = tail.load(std::memory_order_relaxed);
+		if (t == head.load(std::memory_order_acquire)) return false;
+		item = items[t & mask];
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	size_t size() const { return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire); }
+	size_t capacity() const { return items.size(); }
+};
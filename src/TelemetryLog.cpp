@@ -0,0 +1,221 @@
+#include "TelemetryLog.h"
+#include <cstring>
+#include <cstddef>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+static TelemetryColumn column(const char* name, TelemetryType type, size_t offset) {
+	TelemetryColumn c;
+	memset(&c, 0, sizeof(c));
+	strncpy(c.name, name, sizeof(c.name) - 1);
+	c.type = type;
+	c.offset = (uint32_t)offset;
+	return c;
+}
+
+#define SAMPLE_COLUMN(name, field, type) column(name, type, offsetof(TelemetrySample, field))
+
+// The columns of a log, in the order they are written
+const vector<TelemetryColumn>& getTelemetryColumns() {
+	static const vector<TelemetryColumn> columns = {
+		SAMPLE_COLUMN("tick", tick, TelemetryU64),
+		SAMPLE_COLUMN("time", time, TelemetryF64),
+		SAMPLE_COLUMN("x", position[0], TelemetryF32),
+		SAMPLE_COLUMN("y", position[1], TelemetryF32),
+		SAMPLE_COLUMN("z", position[2], TelemetryF32),
+		SAMPLE_COLUMN("vx", velocity[0], TelemetryF32),
+		SAMPLE_COLUMN("vy", velocity[1], TelemetryF32),
+		SAMPLE_COLUMN("vz", velocity[2], TelemetryF32),
+		SAMPLE_COLUMN("ax", acceleration[0], TelemetryF32),
+		SAMPLE_COLUMN("ay", acceleration[1], TelemetryF32),
+		SAMPLE_COLUMN("az", acceleration[2], TelemetryF32),
+		SAMPLE_COLUMN("rotation", rotation, TelemetryF32),
+		SAMPLE_COLUMN("angular_velocity", angularVelocity, TelemetryF32),
+		SAMPLE_COLUMN("thrust_x", thrust[0], TelemetryF32),
+		SAMPLE_COLUMN("thrust_y", thrust[1], TelemetryF32),
+		SAMPLE_COLUMN("thrust_z", thrust[2], TelemetryF32),
+		SAMPLE_COLUMN("torque", torque, TelemetryF32),
+		SAMPLE_COLUMN("fuel", fuel, TelemetryF32),
+		SAMPLE_COLUMN("agl", agl, TelemetryF32),
+		SAMPLE_COLUMN("slope", slope, TelemetryF32),
+		SAMPLE_COLUMN("impact_speed", impactSpeed, TelemetryF32),
+		SAMPLE_COLUMN("input", input, TelemetryU32),
+		SAMPLE_COLUMN("events", events, TelemetryU32),
+		SAMPLE_COLUMN("collisions", numCollisions, TelemetryU32),
+		SAMPLE_COLUMN("state", state, TelemetryU8),
+	};
+	return columns;
+}
+
+size_t getTelemetryTypeSize(uint32_t type) {
+	switch (type) {
+	case TelemetryU8: return 1;
+	case TelemetryU32: return 4;
+	case TelemetryF32: return 4;
+	case TelemetryU64: return 8;
+	case TelemetryF64: return 8;
+	default: return 0;
+	}
+}
+
+/* open() starts a new log at path, or with bAppend carries on with the log there,
+ * adding blocks after its last. */
+bool TelemetryWriter::open(const string& path, bool bAppend) {
+	close();
+
+	// Only a log that is already there can be carried on with
+	if (bAppend && !ifstream(path, ios::binary)) bAppend = false;
+
+	out.open(path, bAppend ? ios::binary | ios::app : ios::binary);
+	if (!out) {
+		cout << "Error: Can't write " << path << endl;
+		return false;
+	}
+
+	if (!bAppend) {
+		const vector<TelemetryColumn>& columns = getTelemetryColumns();
+		TelemetryHeader header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, "LLTM", 4);
+		header.version = 1;
+		header.numColumns = (uint32_t)columns.size();
+		out.write((const char*)&header, sizeof(header));
+		out.write((const char*)columns.data(), columns.size() * sizeof(TelemetryColumn));
+	}
+
+	ring.setup(ringCapacity);
+	block.clear();
+	block.reserve(blockSamples);
+	column.resize(blockSamples * sizeof(double));
+	numDropped = 0;
+	numWritten = 0;
+	bStop = false;
+	bOpen = true;
+	writer = thread(&TelemetryWriter::threadedFunction, this);
+	return true;
+}
+
+// Write out everything logged so far and close the file
+void TelemetryWriter::close() {
+	if (!bOpen) return;
+
+	bStop = true;
+	writer.join();
+	out.close();
+	bOpen = false;
+
+	if (numDropped > 0) {
+		cout << "Telemetry dropped " << numDropped << " samples" << endl;
+	}
+}
+
+// Hand a sample to the writer thread; false if it had to be dropped
+bool TelemetryWriter::log(const TelemetrySample& sample) {
+	if (!bOpen) return false;
+	if (!ring.push(sample)) {
+		numDropped++;
+		return false;
+	}
+	return true;
+}
+
+/* threadedFunction() drains the ring into blocks, writing each once it is full,
+ * or once flushMillis have passed so a crash loses little. It polls rather than
+ * waits on a condition so that log() never has to touch a lock. */
+void TelemetryWriter::threadedFunction() {
+	chrono::steady_clock::time_point blockStart = chrono::steady_clock::now();
+	while (true) {
+		// Read the flag first, so nothing logged before close() is left behind
+		bool bStopping = bStop;
+
+		TelemetrySample sample;
+		while (block.size() < blockSamples && ring.pop(sample)) {
+			if (block.size() == 0) blockStart = chrono::steady_clock::now();
+			block.push_back(sample);
+		}
+
+		bool bFlush = block.size() > 0 &&
+			chrono::steady_clock::now() - blockStart > chrono::milliseconds(flushMillis);
+		if (block.size() == blockSamples || bFlush || (bStopping && block.size() > 0)) {
+			writeBlock();
+			continue;
+		}
+		if (bStopping) break;
+
+		this_thread::sleep_for(chrono::milliseconds(2));
+	}
+	out.flush();
+}
+
+// Write the block column by column, then start a new one
+void TelemetryWriter::writeBlock() {
+	uint32_t numSamples = (uint32_t)block.size();
+	out.write((const char*)&numSamples, sizeof(numSamples));
+
+	const vector<TelemetryColumn>& columns = getTelemetryColumns();
+	for (size_t c = 0; c < columns.size(); c++) {
+		size_t size = getTelemetryTypeSize(columns[c].type);
+		for (uint32_t i = 0; i < numSamples; i++) {
+			memcpy(&column[i * size], (const char*)&block[i] + columns[c].offset, size);
+		}
+		out.write(column.data(), numSamples * size);
+	}
+
+	numWritten += numSamples;
+	block.clear();
+}
+
+//--------------------------------------------------------------
+bool TelemetryReader::open(const string& path) {
+	in.open(path, ios::binary);
+	if (!in) {
+		cout << "Error: Can't read " << path << endl;
+		return false;
+	}
+
+	TelemetryHeader header;
+	if (!in.read((char*)&header, sizeof(header)) || memcmp(header.magic, "LLTM", 4) != 0 || header.version != 1) {
+		cout << "Error: " << path << " is not a telemetry log" << endl;
+		return false;
+	}
+
+	columns.resize(header.numColumns);
+	if (!in.read((char*)columns.data(), header.numColumns * sizeof(TelemetryColumn))) {
+		cout << "Error: " << path << " is truncated" << endl;
+		return false;
+	}
+	values.resize(header.numColumns);
+	return true;
+}
+
+// Read the next block; false at the end of the log, or where it was cut off
+bool TelemetryReader::readBlock() {
+	numSamples = 0;
+	uint32_t n;
+	if (!in.read((char*)&n, sizeof(n))) return false;
+
+	for (size_t c = 0; c < columns.size(); c++) {
+		values[c].resize(n * getTelemetryTypeSize(columns[c].type));
+		if (!in.read(values[c].data(), values[c].size())) return false;
+	}
+	numSamples = n;
+	return true;
+}
+
+// A value of the block as text
+string TelemetryReader::format(int c, uint32_t i) const {
+	const char* p = &values[c][i * getTelemetryTypeSize(columns[c].type)];
+	ostringstream s;
+	s.precision(9);
+	switch (columns[c].type) {
+	case TelemetryU8: s << (unsigned)*(const uint8_t*)p; break;
+	case TelemetryU32: { uint32_t v; memcpy(&v, p, 4); s << v; break; }
+	case TelemetryU64: { uint64_t v; memcpy(&v, p, 8); s << v; break; }
+	case TelemetryF32: { float v; memcpy(&v, p, 4); s << v; break; }
+	case TelemetryF64: { double v; s.precision(17); memcpy(&v, p, 8); s << v; break; }
+	}
+	return s.str();
+}
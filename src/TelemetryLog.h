@@ -0,0 +1,111 @@
+#pragma once
+
+#include "SpscRing.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <thread>
+#include <fstream>
+
+/*
+ * Telemetry logs hold the state of the lander for every simulation tick, for
+ * plotting and analysis after a flight. They are columnar: samples are gathered
+ * into blocks and each block is written one column after another, which keeps a
+ * column's values together for compression and for tools that only need a few.
+ *
+ *      TelemetryHeader
+ *      TelemetryColumn[numColumns]
+ *      blocks, each: uint32 numSamples, then for every column numSamples values
+ *
+ * tools/telemetry2csv converts a log to CSV.
+ */
+
+typedef enum { TelemetryU8, TelemetryU32, TelemetryU64, TelemetryF32, TelemetryF64 } TelemetryType;
+
+struct TelemetryHeader {
+	char magic[4];      // "LLTM"
+	uint32_t version;
+	uint32_t numColumns;
+	uint32_t reserved;
+};
+
+struct TelemetryColumn {
+	char name[24];
+	uint32_t type;      // TelemetryType
+	uint32_t offset;    // into TelemetrySample, unused by readers
+};
+
+// One tick of flight, as handed from the simulation to the writer
+struct TelemetrySample {
+	uint64_t tick;
+	double time;
+	float position[3];
+	float velocity[3];
+	float acceleration[3];
+	float rotation;
+	float angularVelocity;
+	float thrust[3];    // thruster force
+	float torque;
+	float fuel;
+	float agl;
+	float slope;        // of the ground below, degrees
+	float impactSpeed;
+	uint32_t input;     // INPUT_* bits
+	uint32_t events;    // EVENT_* bits
+	uint32_t numCollisions; // terrain boxes touching the lander
+	uint8_t state;      // GameState
+};
+
+const std::vector<TelemetryColumn>& getTelemetryColumns();
+size_t getTelemetryTypeSize(uint32_t type);
+
+/* TelemetryWriter writes a log from a thread of its own. log() only copies the
+ * sample into a lock-free ring and never waits on the disk, so it is safe to call
+ * from the simulation at any rate; if the writer falls so far behind that the ring
+ * fills up, samples are dropped and counted instead. */
+class TelemetryWriter {
+public:
+	~TelemetryWriter() { close(); }
+
+	bool open(const std::string& path, bool bAppend = false);
+	void close();
+	bool isOpen() const { return bOpen; }
+
+	bool log(const TelemetrySample& sample);
+	uint64_t getNumDropped() const { return numDropped; }
+	uint64_t getNumWritten() const { return numWritten; }
+
+	size_t ringCapacity = 16384; // samples, 16 s at 1 kHz
+	size_t blockSamples = 1024;
+	int flushMillis = 500;       // write out a partial block after this long
+
+private:
+	void threadedFunction();
+	void writeBlock();
+
+	SpscRing<TelemetrySample> ring;
+	std::vector<TelemetrySample> block;
+	std::vector<char> column;
+	std::ofstream out;
+	std::thread writer;
+	std::atomic<bool> bStop{ false };
+	bool bOpen = false;
+	std::atomic<uint64_t> numDropped{ 0 };
+	uint64_t numWritten = 0;
+};
+
+// Reads a log a block at a time
+class TelemetryReader {
+public:
+	bool open(const std::string& path);
+	bool readBlock();
+
+	std::vector<TelemetryColumn> columns;
+	uint32_t numSamples = 0;                // in the block just read
+	std::vector<std::vector<char>> values;  // per column, numSamples values
+
+	std::string format(int column, uint32_t sample) const;
+
+private:
+	std::ifstream in;
+};
@@ -0,0 +1,303 @@
+#include "TerrainRenderer.h"
+#include "Profiler.h"
+#include <unordered_map>
+
+// setup() builds the chunks and uploads them right away
+void TerrainRenderer::setup(const ofMesh& mesh, const Octree& octree, int chunkLevel) {
+	build(mesh, octree, chunkLevel);
+	upload();
+}
+
+/* build() groups the terrain's triangles into chunks. Each node at depth chunkLevel
+ * (or each shallower leaf) becomes a chunk; a triangle goes to the chunk that holds
+ * its first vertex and the chunk bounds grow to cover all of its triangles. The
+ * simplified levels of every chunk are appended behind the full resolution mesh in
+ * the same buffers. build() makes no GL calls, so it may run on a worker thread. */
+void TerrainRenderer::build(const ofMesh& mesh, const Octree& octree, int chunkLevel) {
+	chunks.clear();
+
+	vector<int> vertexChunk(mesh.getNumVertices(), -1);
+	assignChunks(octree.root, chunkLevel, 0, vertexChunk);
+
+	// Triangles whose vertices no node claimed go into a final, always drawn chunk
+	int strayChunk = (int)chunks.size();
+	chunks.push_back(TerrainChunk());
+
+	vector<ofIndexType> indices = mesh.getIndices();
+	if (indices.size() == 0) {
+		for (int i = 0; i < mesh.getNumVertices(); i++) indices.push_back(i);
+	}
+	int numTris = (int)indices.size() / 3;
+
+	vector<int> triChunk(numTris);
+	vector<int> counts(chunks.size(), 0);
+	for (int t = 0; t < numTris; t++) {
+		int c = -1;
+		for (int k = 0; k < 3 && c < 0; k++) c = vertexChunk[indices[3 * t + k]];
+		if (c < 0) c = strayChunk;
+		triChunk[t] = c;
+		counts[c]++;
+	}
+
+	// Counting sort of the triangles by chunk
+	int offset = 0;
+	for (int c = 0; c < chunks.size(); c++) {
+		chunks[c].lods.assign(1, TerrainLod());
+		chunks[c].lods[0].indexStart = offset;
+		offset += counts[c] * 3;
+	}
+
+	vector<ofIndexType>& sortedIndices = indexData;
+	sortedIndices.assign(numTris * 3, 0);
+	vector<glm::vec3> mins(chunks.size(), glm::vec3(FLT_MAX, FLT_MAX, FLT_MAX));
+	vector<glm::vec3> maxs(chunks.size(), glm::vec3(-FLT_MAX, -FLT_MAX, -FLT_MAX));
+	for (int t = 0; t < numTris; t++) {
+		TerrainLod& lod = chunks[triChunk[t]].lods[0];
+		for (int k = 0; k < 3; k++) {
+			ofIndexType index = indices[3 * t + k];
+			sortedIndices[lod.indexStart + lod.indexCount++] = index;
+
+			glm::vec3 v = mesh.getVertex(index);
+			glm::vec3& lo = mins[triChunk[t]];
+			glm::vec3& hi = maxs[triChunk[t]];
+			lo = glm::vec3(min(lo.x, v.x), min(lo.y, v.y), min(lo.z, v.z));
+			hi = glm::vec3(max(hi.x, v.x), max(hi.y, v.y), max(hi.z, v.z));
+		}
+	}
+
+	for (int c = 0; c < chunks.size(); c++) {
+		chunks[c].box = Box(mins[c], maxs[c]);
+	}
+	chunks[strayChunk].box = Box(Vector3(-FLT_MAX, -FLT_MAX, -FLT_MAX), Vector3(FLT_MAX, FLT_MAX, FLT_MAX));
+
+	vertexData = mesh.getVertices();
+	normalData = mesh.getNormals();
+	texCoordData = mesh.getTexCoords();
+	for (int c = 0; c < strayChunk; c++) {
+		buildLods(chunks[c], vertexData, normalData, texCoordData, indexData);
+	}
+}
+
+/* upload() sends the data prepared by build() to the GPU and frees the CPU copy.
+ * Must be called on the GL thread. */
+void TerrainRenderer::upload() {
+	vbo.setVertexData(vertexData.data(), (int)vertexData.size(), GL_STATIC_DRAW);
+	if (normalData.size() > 0) vbo.setNormalData(normalData.data(), (int)normalData.size(), GL_STATIC_DRAW);
+	if (texCoordData.size() > 0) vbo.setTexCoordData(texCoordData.data(), (int)texCoordData.size(), GL_STATIC_DRAW);
+	vbo.setIndexData(indexData.data(), (int)indexData.size(), GL_STATIC_DRAW);
+
+	vector<glm::vec3>().swap(vertexData);
+	vector<glm::vec3>().swap(normalData);
+	vector<glm::vec2>().swap(texCoordData);
+	vector<ofIndexType>().swap(indexData);
+}
+
+/* buildLods() adds coarser versions of a chunk until it has maxLodLevels levels or
+ * stops getting simpler. Level k snaps vertices to a grid with cells 2^k times the
+ * average edge length, merging every cluster into its average vertex and dropping
+ * the triangles that collapse. The cell size bounds how far the simplified surface
+ * can stray, so it is stored as the level's error. */
+void TerrainRenderer::buildLods(TerrainChunk& chunk, vector<glm::vec3>& verts, vector<glm::vec3>& norms,
+	vector<glm::vec2>& uvs, vector<ofIndexType>& indices)
+{
+	const TerrainLod base = chunk.lods[0];
+	if (base.indexCount == 0) return;
+
+	float edgeSum = 0;
+	for (int i = 0; i < base.indexCount; i += 3) {
+		const ofIndexType* tri = &indices[base.indexStart + i];
+		edgeSum += glm::length(verts[tri[1]] - verts[tri[0]]) + glm::length(verts[tri[2]] - verts[tri[1]]);
+	}
+	float baseCell = edgeSum / (base.indexCount / 3 * 2);
+	if (baseCell <= 0) return;
+
+	bool hasNormals = norms.size() > 0;
+	bool hasUvs = uvs.size() > 0;
+	Vector3 origin = chunk.box.min();
+
+	int prevTriangles = base.indexCount / 3;
+	for (int level = 1; level < maxLodLevels; level++) {
+		float cell = baseCell * (1 << level);
+
+		// Cluster the chunk's vertices on the grid
+		unordered_map<int64_t, int> clusterOfKey;
+		unordered_map<ofIndexType, int> clusterOfVertex;
+		vector<glm::vec3> sumPos, sumNorm;
+		vector<glm::vec2> sumUv;
+		vector<int> count;
+		for (int i = 0; i < base.indexCount; i++) {
+			ofIndexType v = indices[base.indexStart + i];
+			if (clusterOfVertex.count(v) > 0) continue;
+
+			glm::vec3 p = verts[v];
+			int64_t cx = (int64_t)floorf((p.x - origin.x()) / cell);
+			int64_t cy = (int64_t)floorf((p.y - origin.y()) / cell);
+			int64_t cz = (int64_t)floorf((p.z - origin.z()) / cell);
+			int64_t key = (cx & 0x1fffff) | ((cy & 0x1fffff) << 21) | ((cz & 0x1fffff) << 42);
+
+			unordered_map<int64_t, int>::iterator it = clusterOfKey.find(key);
+			int cluster;
+			if (it == clusterOfKey.end()) {
+				cluster = (int)count.size();
+				clusterOfKey[key] = cluster;
+				sumPos.push_back(glm::vec3(0, 0, 0));
+				sumNorm.push_back(glm::vec3(0, 0, 0));
+				sumUv.push_back(glm::vec2(0, 0));
+				count.push_back(0);
+			}
+			else {
+				cluster = it->second;
+			}
+			clusterOfVertex[v] = cluster;
+
+			sumPos[cluster] += p;
+			if (hasNormals) sumNorm[cluster] += norms[v];
+			if (hasUvs) {
+				sumUv[cluster].x += uvs[v].x;
+				sumUv[cluster].y += uvs[v].y;
+			}
+			count[cluster]++;
+		}
+
+		// One new vertex per cluster, appended behind everything built so far
+		ofIndexType firstVertex = (ofIndexType)verts.size();
+		for (int c = 0; c < count.size(); c++) {
+			verts.push_back(sumPos[c] / (float)count[c]);
+			if (hasNormals) norms.push_back(glm::normalize(sumNorm[c]));
+			if (hasUvs) uvs.push_back(glm::vec2(sumUv[c].x / count[c], sumUv[c].y / count[c]));
+		}
+
+		TerrainLod lod;
+		lod.indexStart = (int)indices.size();
+		lod.error = cell;
+
+		// Keep the triangles that did not collapse and count how often each edge is used
+		map<pair<ofIndexType, ofIndexType>, int> edgeUse;
+		vector<pair<ofIndexType, ofIndexType>> edges;
+		for (int i = 0; i < base.indexCount; i += 3) {
+			ofIndexType a = firstVertex + clusterOfVertex[indices[base.indexStart + i]];
+			ofIndexType b = firstVertex + clusterOfVertex[indices[base.indexStart + i + 1]];
+			ofIndexType c = firstVertex + clusterOfVertex[indices[base.indexStart + i + 2]];
+			if (a == b || b == c || a == c) continue;
+
+			indices.push_back(a);
+			indices.push_back(b);
+			indices.push_back(c);
+
+			ofIndexType tri[3] = { a, b, c };
+			for (int k = 0; k < 3; k++) {
+				ofIndexType e0 = tri[k], e1 = tri[(k + 1) % 3];
+				pair<ofIndexType, ofIndexType> key(min(e0, e1), max(e0, e1));
+				if (edgeUse[key]++ == 0) edges.push_back(make_pair(e0, e1));
+			}
+		}
+		int numTriangles = ((int)indices.size() - lod.indexStart) / 3;
+
+		// Hang a skirt of depth cell below every border edge
+		map<ofIndexType, ofIndexType> lowered;
+		for (int i = 0; i < edges.size(); i++) {
+			ofIndexType a = edges[i].first, b = edges[i].second;
+			if (edgeUse[make_pair(min(a, b), max(a, b))] != 1) continue;
+
+			ofIndexType ends[2] = { a, b };
+			ofIndexType low[2];
+			for (int k = 0; k < 2; k++) {
+				map<ofIndexType, ofIndexType>::iterator it = lowered.find(ends[k]);
+				if (it == lowered.end()) {
+					low[k] = (ofIndexType)verts.size();
+					lowered[ends[k]] = low[k];
+					verts.push_back(verts[ends[k]] - glm::vec3(0, cell, 0));
+					if (hasNormals) norms.push_back(norms[ends[k]]);
+					if (hasUvs) uvs.push_back(uvs[ends[k]]);
+				}
+				else {
+					low[k] = it->second;
+				}
+			}
+
+			indices.push_back(a);
+			indices.push_back(b);
+			indices.push_back(low[1]);
+			indices.push_back(a);
+			indices.push_back(low[1]);
+			indices.push_back(low[0]);
+		}
+
+		lod.indexCount = (int)indices.size() - lod.indexStart;
+		chunk.lods.push_back(lod);
+
+		if (numTriangles < 8 || numTriangles == prevTriangles) break;
+		prevTriangles = numTriangles;
+	}
+}
+
+// Distance from p to the closest point of box, 0 if p is inside
+float TerrainRenderer::distanceToBox(const glm::vec3& p, const Box& box) const {
+	Vector3 q = p;
+	return Vector3::max(Vector3::max(box.min() - q, Vector3()), q - box.max()).length();
+}
+
+// Give every vertex the index of the chunk it belongs to, creating chunks on the way
+void TerrainRenderer::assignChunks(const TreeNode& node, int chunkLevel, int level, vector<int>& vertexChunk) {
+	if (level < chunkLevel && node.children.size() > 0) {
+		for (int i = 0; i < node.children.size(); i++) {
+			assignChunks(node.children[i], chunkLevel, level + 1, vertexChunk);
+		}
+		return;
+	}
+
+	int c = (int)chunks.size();
+	chunks.push_back(TerrainChunk());
+	for (int i = 0; i < node.points.size(); i++) {
+		if (vertexChunk[node.points[i]] < 0) vertexChunk[node.points[i]] = c;
+	}
+}
+
+/* draw() renders the chunks that intersect the camera frustum, each at the
+ * coarsest level whose error stays under maxScreenError pixels on screen. Runs of
+ * adjacent ranges are merged into a single draw call. */
+void TerrainRenderer::draw(const ofCamera& cam) {
+	ProfileScope scope("terrain draw");
+
+	Frustum frustum(cam.getModelViewProjectionMatrix());
+	glm::vec3 camPos = cam.getPosition();
+
+	// Pixels covered by one world unit at distance 1
+	float pixelsPerUnit = ofGetViewportHeight() / (2.0f * tan(glm::radians(cam.getFov()) / 2.0f));
+
+	material.begin();
+	if (bTextured) texture.bind();
+
+	numVisible = 0;
+	numTriangles = 0;
+	int runStart = -1, runCount = 0;
+	for (int c = 0; c < chunks.size(); c++) {
+		TerrainChunk& chunk = chunks[c];
+		if (chunk.lods[0].indexCount == 0 || !frustum.intersect(chunk.box)) continue;
+		numVisible++;
+
+		float distance = distanceToBox(camPos, chunk.box);
+		chunk.lod = 0;
+		for (int l = (int)chunk.lods.size() - 1; l > 0; l--) {
+			if (distance > 0 && chunk.lods[l].error * pixelsPerUnit / distance <= maxScreenError) {
+				chunk.lod = l;
+				break;
+			}
+		}
+
+		const TerrainLod& lod = chunk.lods[chunk.lod];
+		numTriangles += lod.indexCount / 3;
+
+		if (runStart >= 0 && runStart + runCount == lod.indexStart) {
+			runCount += lod.indexCount;
+			continue;
+		}
+		if (runCount > 0) vbo.drawElements(GL_TRIANGLES, runCount, runStart);
+		runStart = lod.indexStart;
+		runCount = lod.indexCount;
+	}
+	if (runCount > 0) vbo.drawElements(GL_TRIANGLES, runCount, runStart);
+
+	if (bTextured) texture.unbind();
+	material.end();
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "ofMain.h"
+#include "Octree.h"
+#include "Frustum.h"
+
+// One level of detail of a chunk: a range of the index buffer and the largest
+// distance, in world units, between it and the full resolution surface
+class TerrainLod {
+public:
+	int indexStart = 0;
+	int indexCount = 0;
+	float error = 0;
+};
+
+// A piece of the terrain with its bounds and its levels of detail, finest first
+class TerrainChunk {
+public:
+	Box box;
+	vector<TerrainLod> lods;
+	int lod = 0; // level selected in the last draw
+};
+
+// TerrainRenderer splits the terrain into chunks, one per octree node at a fixed
+// depth, and draws only the chunks whose bounds intersect the camera frustum.
+// Every chunk also carries simplified versions of itself, built by vertex
+// clustering, and each frame the coarsest version whose error projects to at
+// most maxScreenError pixels is drawn. Simplified versions hang skirts off their
+// border edges so no cracks open up between chunks of different detail.
+class TerrainRenderer {
+private:
+	void assignChunks(const TreeNode& node, int chunkLevel, int level, vector<int>& vertexChunk);
+	void buildLods(TerrainChunk& chunk, vector<glm::vec3>& verts, vector<glm::vec3>& norms,
+		vector<glm::vec2>& uvs, vector<ofIndexType>& indices);
+	float distanceToBox(const glm::vec3& p, const Box& box) const;
+
+	// geometry waiting for upload()
+	vector<glm::vec3> vertexData, normalData;
+	vector<glm::vec2> texCoordData;
+	vector<ofIndexType> indexData;
+
+	ofVbo vbo;
+	ofMaterial material;
+	ofTexture texture;
+	bool bTextured = false;
+public:
+	void setup(const ofMesh& mesh, const Octree& octree, int chunkLevel);
+	void build(const ofMesh& mesh, const Octree& octree, int chunkLevel);
+	void upload();
+	void setMaterial(const ofMaterial& m) { material = m; }
+	void setTexture(const ofTexture& t) { texture = t; bTextured = t.isAllocated(); }
+	void draw(const ofCamera& cam);
+
+	vector<TerrainChunk> chunks;
+	int maxLodLevels = 5;
+	float maxScreenError = 2.0f;
+	int numVisible = 0;
+	int numTriangles = 0;
+};
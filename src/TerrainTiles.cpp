@@ -0,0 +1,322 @@
+#include "TerrainTiles.h"
+#include <fstream>
+#include <cstring>
+#include <unordered_map>
+
+/* bake() cuts a mesh into tiles of tileSize x tileSize on the XZ plane and writes
+ * them in the tiled format. A triangle belongs to the tile under its centroid. */
+bool TerrainStreamer::bake(const ofMesh& mesh, const string& dir, float tileSize) {
+	Box bounds = Octree::meshBounds(mesh);
+
+	TileIndexHeader hdr;
+	memcpy(hdr.magic, "LLTI", 4);
+	hdr.version = 1;
+	hdr.tileSize = tileSize;
+	hdr.originX = bounds.min().x();
+	hdr.originZ = bounds.min().z();
+	hdr.tilesX = max(1, (int)ceil((bounds.max().x() - hdr.originX) / tileSize));
+	hdr.tilesZ = max(1, (int)ceil((bounds.max().z() - hdr.originZ) / tileSize));
+
+	vector<ofIndexType> indices = mesh.getIndices();
+	if (indices.size() == 0) {
+		for (int i = 0; i < mesh.getNumVertices(); i++) indices.push_back(i);
+	}
+
+	// Bucket the triangles by tile
+	vector<vector<int>> tileTris(hdr.tilesX * hdr.tilesZ);
+	for (int t = 0; t < indices.size() / 3; t++) {
+		glm::vec3 c = (mesh.getVertex(indices[3 * t]) + mesh.getVertex(indices[3 * t + 1]) +
+			mesh.getVertex(indices[3 * t + 2])) / 3.0f;
+		int tx = ofClamp((int)((c.x - hdr.originX) / tileSize), 0, hdr.tilesX - 1);
+		int tz = ofClamp((int)((c.z - hdr.originZ) / tileSize), 0, hdr.tilesZ - 1);
+		tileTris[tz * hdr.tilesX + tx].push_back(t);
+	}
+
+	ofDirectory::createDirectory(dir, false, true);
+
+	bool hasNormals = mesh.getNumNormals() == mesh.getNumVertices();
+	bool hasTexCoords = mesh.getNumTexCoords() == mesh.getNumVertices();
+
+	vector<TileIndexEntry> tileEntries(tileTris.size());
+	for (int z = 0; z < hdr.tilesZ; z++) {
+		for (int x = 0; x < hdr.tilesX; x++) {
+			int k = z * hdr.tilesX + x;
+			const vector<int>& tris = tileTris[k];
+
+			// Renumber the tile's vertices locally
+			unordered_map<ofIndexType, uint32_t> local;
+			vector<glm::vec3> verts, norms;
+			vector<glm::vec2> uvs;
+			vector<uint32_t> tileIndices;
+			glm::vec3 lo(FLT_MAX, FLT_MAX, FLT_MAX), hi(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+			for (int i = 0; i < tris.size(); i++) {
+				for (int j = 0; j < 3; j++) {
+					ofIndexType v = indices[3 * tris[i] + j];
+					unordered_map<ofIndexType, uint32_t>::iterator it = local.find(v);
+					if (it == local.end()) {
+						it = local.insert(make_pair(v, (uint32_t)verts.size())).first;
+						glm::vec3 p = mesh.getVertex(v);
+						verts.push_back(p);
+						if (hasNormals) norms.push_back(mesh.getNormals()[v]);
+						if (hasTexCoords) uvs.push_back(mesh.getTexCoords()[v]);
+						lo = glm::vec3(min(lo.x, p.x), min(lo.y, p.y), min(lo.z, p.z));
+						hi = glm::vec3(max(hi.x, p.x), max(hi.y, p.y), max(hi.z, p.z));
+					}
+					tileIndices.push_back(it->second);
+				}
+			}
+
+			TileIndexEntry& entry = tileEntries[k];
+			entry.min[0] = lo.x; entry.min[1] = lo.y; entry.min[2] = lo.z;
+			entry.max[0] = hi.x; entry.max[1] = hi.y; entry.max[2] = hi.z;
+			entry.numVertices = (uint32_t)verts.size();
+			entry.numIndices = (uint32_t)tileIndices.size();
+			entry.hasNormals = hasNormals;
+			entry.hasTexCoords = hasTexCoords;
+			if (verts.size() == 0) continue;
+
+			ofstream out(ofToDataPath(dir + "/tile_" + ofToString(x) + "_" + ofToString(z) + ".bin"), ios::binary);
+			out.write((const char*)verts.data(), verts.size() * sizeof(glm::vec3));
+			out.write((const char*)norms.data(), norms.size() * sizeof(glm::vec3));
+			out.write((const char*)uvs.data(), uvs.size() * sizeof(glm::vec2));
+			out.write((const char*)tileIndices.data(), tileIndices.size() * sizeof(uint32_t));
+			if (!out) {
+				cout << "Error: Can't write terrain tile in " << dir << endl;
+				return false;
+			}
+		}
+	}
+
+	ofstream out(ofToDataPath(dir + "/index.bin"), ios::binary);
+	out.write((const char*)&hdr, sizeof(hdr));
+	out.write((const char*)tileEntries.data(), tileEntries.size() * sizeof(TileIndexEntry));
+	cout << "baked " << hdr.tilesX << " x " << hdr.tilesZ << " terrain tiles into " << dir << endl;
+	return (bool)out;
+}
+
+/* open() reads the tile index and starts the loader thread. */
+bool TerrainStreamer::open(const string& path) {
+	close();
+	dir = path;
+
+	ifstream in(ofToDataPath(dir + "/index.bin"), ios::binary);
+	if (!in.read((char*)&header, sizeof(header)) || memcmp(header.magic, "LLTI", 4) != 0 || header.version != 1) {
+		cout << "Error: Can't read terrain tile index in " << dir << endl;
+		return false;
+	}
+	entries.resize(header.tilesX * header.tilesZ);
+	if (!in.read((char*)entries.data(), entries.size() * sizeof(TileIndexEntry))) {
+		cout << "Error: Terrain tile index in " << dir << " is truncated" << endl;
+		return false;
+	}
+
+	bStopLoader = false;
+	loader = thread(&TerrainStreamer::threadedFunction, this);
+	return true;
+}
+
+// Stop the loader thread and drop every tile
+void TerrainStreamer::close() {
+	if (loader.joinable()) {
+		{
+			lock_guard<mutex> lock(queueMutex);
+			bStopLoader = true;
+			requests.clear();
+		}
+		queueCondition.notify_all();
+		loader.join();
+	}
+	{
+		lock_guard<mutex> lock(tilesMutex);
+		tiles.clear();
+	}
+	pending.clear();
+	loaded.clear();
+	loadedBytes = 0;
+}
+
+string TerrainStreamer::tilePath(int x, int z) const {
+	return ofToDataPath(dir + "/tile_" + ofToString(x) + "_" + ofToString(z) + ".bin");
+}
+
+// Memory a tile takes once loaded: the mesh data plus roughly as much again for its octree
+size_t TerrainStreamer::estimateBytes(const TileIndexEntry& entry) const {
+	size_t vertexBytes = sizeof(glm::vec3) * (entry.hasNormals ? 2 : 1) + (entry.hasTexCoords ? sizeof(glm::vec2) : 0);
+	size_t meshBytes = entry.numVertices * vertexBytes + entry.numIndices * sizeof(ofIndexType);
+	return meshBytes + entry.numVertices * sizeof(int) * octreeLevels;
+}
+
+float TerrainStreamer::distanceXZ(const glm::vec3& p, const Box& box) const {
+	float dx = max(max(box.parameters[0].x() - p.x, 0.0f), p.x - box.parameters[1].x());
+	float dz = max(max(box.parameters[0].z() - p.z, 0.0f), p.z - box.parameters[1].z());
+	return sqrt(dx * dx + dz * dz);
+}
+
+// Loader thread: read requested tiles and build their octrees
+void TerrainStreamer::threadedFunction() {
+	while (true) {
+		int k;
+		{
+			unique_lock<mutex> lock(queueMutex);
+			queueCondition.wait(lock, [this] { return bStopLoader || requests.size() > 0; });
+			if (bStopLoader) return;
+			k = requests.front();
+			requests.pop_front();
+		}
+
+		shared_ptr<TerrainTile> tile = loadTile(k % header.tilesX, k / header.tilesX);
+
+		lock_guard<mutex> lock(queueMutex);
+		loaded.push_back(tile);
+	}
+}
+
+shared_ptr<TerrainTile> TerrainStreamer::loadTile(int x, int z) {
+	const TileIndexEntry& entry = entries[key(x, z)];
+	shared_ptr<TerrainTile> tile = make_shared<TerrainTile>();
+	tile->x = x;
+	tile->z = z;
+	tile->box = Box(Vector3(entry.min[0], entry.min[1], entry.min[2]), Vector3(entry.max[0], entry.max[1], entry.max[2]));
+	tile->bytes = estimateBytes(entry);
+
+	ifstream in(tilePath(x, z), ios::binary);
+	vector<glm::vec3>& verts = tile->mesh.getVertices();
+	vector<glm::vec3>& norms = tile->mesh.getNormals();
+	vector<glm::vec2>& uvs = tile->mesh.getTexCoords();
+	vector<uint32_t> indices(entry.numIndices);
+	verts.resize(entry.numVertices);
+	norms.resize(entry.hasNormals ? entry.numVertices : 0);
+	uvs.resize(entry.hasTexCoords ? entry.numVertices : 0);
+	in.read((char*)verts.data(), verts.size() * sizeof(glm::vec3));
+	in.read((char*)norms.data(), norms.size() * sizeof(glm::vec3));
+	in.read((char*)uvs.data(), uvs.size() * sizeof(glm::vec2));
+	in.read((char*)indices.data(), indices.size() * sizeof(uint32_t));
+	if (!in) {
+		cout << "Error: Can't read terrain tile " << tilePath(x, z) << endl;
+		tile->mesh.clear();
+		return tile;
+	}
+	tile->mesh.getIndices().assign(indices.begin(), indices.end());
+
+	tile->octree.create(tile->mesh, octreeLevels);
+	return tile;
+}
+
+/* update() runs on the main thread. It collects finished tiles, uploads them,
+ * requests the missing tiles within loadRadius of focus (nearest first, as far as
+ * the budget allows) and evicts the farthest tiles while over budget. */
+void TerrainStreamer::update(const glm::vec3& focus) {
+	if (entries.size() == 0) return;
+
+	deque<shared_ptr<TerrainTile>> arrived;
+	{
+		lock_guard<mutex> lock(queueMutex);
+		arrived.swap(loaded);
+	}
+	for (int i = 0; i < arrived.size(); i++) {
+		shared_ptr<TerrainTile> tile = arrived[i];
+		int k = key(tile->x, tile->z);
+		pending.erase(k);
+		if (distanceXZ(focus, tile->box) > loadRadius) continue;
+
+		if (tile->mesh.getNumVertices() > 0) {
+			tile->vbo.setMesh(tile->mesh, GL_STATIC_DRAW);
+			tile->bUploaded = true;
+		}
+		{
+			lock_guard<mutex> lock(tilesMutex);
+			tiles[k] = tile;
+		}
+		loadedBytes += tile->bytes;
+	}
+
+	// Tiles we want, nearest first
+	vector<pair<float, int>> wanted;
+	for (int k = 0; k < entries.size(); k++) {
+		if (entries[k].numVertices == 0) continue;
+		Box box(Vector3(entries[k].min[0], entries[k].min[1], entries[k].min[2]),
+			Vector3(entries[k].max[0], entries[k].max[1], entries[k].max[2]));
+		float d = distanceXZ(focus, box);
+		if (d <= loadRadius) wanted.push_back(make_pair(d, k));
+	}
+	sort(wanted.begin(), wanted.end());
+
+	size_t projected = loadedBytes;
+	vector<int> newRequests;
+	for (int i = 0; i < wanted.size(); i++) {
+		int k = wanted[i].second;
+		if (tiles.count(k) > 0 || pending.count(k) > 0) continue;
+
+		projected += estimateBytes(entries[k]);
+		if (projected > memoryBudget && i > 0) break;
+		pending.insert(k);
+		newRequests.push_back(k);
+	}
+	if (newRequests.size() > 0) {
+		{
+			lock_guard<mutex> lock(queueMutex);
+			requests.insert(requests.end(), newRequests.begin(), newRequests.end());
+		}
+		queueCondition.notify_one();
+	}
+
+	// Evict out of range tiles, then the farthest ones while over budget
+	vector<pair<float, int>> resident;
+	for (map<int, shared_ptr<TerrainTile>>::iterator it = tiles.begin(); it != tiles.end(); it++) {
+		resident.push_back(make_pair(distanceXZ(focus, it->second->box), it->first));
+	}
+	sort(resident.begin(), resident.end());
+	for (int i = (int)resident.size() - 1; i > 0; i--) {
+		if (resident[i].first <= loadRadius && loadedBytes <= memoryBudget) break;
+		loadedBytes -= tiles[resident[i].second]->bytes;
+		lock_guard<mutex> lock(tilesMutex);
+		tiles.erase(resident[i].second);
+	}
+}
+
+// Draw the resident tiles that intersect the camera frustum
+void TerrainStreamer::draw(const ofCamera& cam) {
+	Frustum frustum(cam.getModelViewProjectionMatrix());
+	material.begin();
+	if (bTextured) texture.bind();
+	for (map<int, shared_ptr<TerrainTile>>::iterator it = tiles.begin(); it != tiles.end(); it++) {
+		TerrainTile& tile = *it->second;
+		if (tile.bUploaded && frustum.intersect(tile.box)) {
+			tile.vbo.drawElements(GL_TRIANGLES, (int)tile.mesh.getNumIndices());
+		}
+	}
+	if (bTextured) texture.unbind();
+	material.end();
+}
+
+/* intersect() casts a ray into the tile under the ray origin and returns the terrain
+ * point of the leaf it hits. Fails if that tile is not resident. */
+bool TerrainStreamer::intersect(const Ray& ray, glm::vec3& pointRtn) {
+	if (entries.size() == 0) return false;
+
+	int x = (int)floorf((ray.origin.x() - header.originX) / header.tileSize);
+	int z = (int)floorf((ray.origin.z() - header.originZ) / header.tileSize);
+	if (x < 0 || z < 0 || x >= header.tilesX || z >= header.tilesZ) return false;
+
+	lock_guard<mutex> lock(tilesMutex);
+	map<int, shared_ptr<TerrainTile>>::iterator it = tiles.find(key(x, z));
+	if (it == tiles.end()) return false;
+
+	TerrainTile& tile = *it->second;
+	NodeHandle node;
+	if (!tile.octree.intersect(ray, tile.octree.root, node) || node.getNumPoints() == 0) return false;
+
+	pointRtn = tile.mesh.getVertex(node.getPoint(0));
+	return true;
+}
+
+// Collect the leaf boxes of all resident tiles that overlap box
+void TerrainStreamer::intersect(const Box& box, vector<Box>& boxListRtn) {
+	lock_guard<mutex> lock(tilesMutex);
+	for (map<int, shared_ptr<TerrainTile>>::iterator it = tiles.begin(); it != tiles.end(); it++) {
+		TerrainTile& tile = *it->second;
+		if (tile.box.overlap(box)) {
+			tile.octree.intersect(box, tile.octree.root, boxListRtn);
+		}
+	}
+}
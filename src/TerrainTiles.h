@@ -0,0 +1,108 @@
+#pragma once
+
+#include "ofMain.h"
+#include "Octree.h"
+#include "Frustum.h"
+#include <condition_variable>
+#include <deque>
+#include <set>
+
+/*
+ * Tiled terrain format. A terrain is cut along a regular XZ grid into tiles that
+ * are stored as separate files next to a small index:
+ *
+ *      <dir>/index.bin       TileIndexHeader followed by tilesX * tilesZ TileIndexEntry
+ *      <dir>/tile_X_Z.bin    vertices (float3), normals (float3), texcoords (float2), indices (uint32)
+ *
+ * Tiles keep their own local vertex numbering so each one can be loaded alone.
+ */
+
+struct TileIndexHeader {
+	char magic[4];      // "LLTI"
+	uint32_t version;
+	uint32_t tilesX, tilesZ;
+	float tileSize;
+	float originX, originZ;
+};
+
+struct TileIndexEntry {
+	float min[3], max[3];
+	uint32_t numVertices;
+	uint32_t numIndices;
+	uint32_t hasNormals, hasTexCoords;
+};
+
+// A tile that has been paged in, with its own octree over its vertices
+class TerrainTile {
+public:
+	int x = 0, z = 0;
+	Box box;
+	ofMesh mesh;
+	Octree octree;
+	ofVbo vbo;
+	bool bUploaded = false;
+	size_t bytes = 0;
+};
+
+// TerrainStreamer keeps the tiles around a focus point in memory. Tiles are read
+// and their octrees built on a background thread; the main thread only uploads
+// finished tiles to the GPU and evicts the farthest tiles when the memory budget
+// is exceeded.
+//
+// Only the lander's collisions and ground height go through the tiles. There is
+// no whole-terrain octree or heightfield while streaming, so particles do not
+// collide with the ground, the sensor suite does not scan and the lander is not
+// filed in a dynamic object index.
+class TerrainStreamer {
+private:
+	void threadedFunction();
+	shared_ptr<TerrainTile> loadTile(int x, int z);
+	string tilePath(int x, int z) const;
+	size_t estimateBytes(const TileIndexEntry& entry) const;
+	float distanceXZ(const glm::vec3& p, const Box& box) const;
+	int key(int x, int z) const { return z * header.tilesX + x; }
+
+	string dir;
+	TileIndexHeader header;
+	vector<TileIndexEntry> entries;
+
+	// Tiles only change on the main thread, under tilesMutex, so that a simulation
+	// on a thread of its own can collide with them
+	map<int, shared_ptr<TerrainTile>> tiles;
+	mutex tilesMutex;
+	set<int> pending;
+	size_t loadedBytes = 0;
+
+	// work queues shared with the loader thread
+	thread loader;
+	mutex queueMutex;
+	condition_variable queueCondition;
+	deque<int> requests;
+	deque<shared_ptr<TerrainTile>> loaded;
+	bool bStopLoader = false;
+
+	ofMaterial material;
+	ofTexture texture;
+	bool bTextured = false;
+public:
+	~TerrainStreamer() { close(); }
+
+	static bool bake(const ofMesh& mesh, const string& dir, float tileSize);
+
+	bool open(const string& dir);
+	void close();
+	void update(const glm::vec3& focus);
+	void setMaterial(const ofMaterial& m) { material = m; }
+	void setTexture(const ofTexture& t) { texture = t; bTextured = t.isAllocated(); }
+	void draw(const ofCamera& cam);
+
+	bool intersect(const Ray& ray, glm::vec3& pointRtn);
+	void intersect(const Box& box, vector<Box>& boxListRtn);
+
+	float loadRadius = 150.0f;
+	size_t memoryBudget = 256 * 1024 * 1024;
+	int octreeLevels = 12;
+
+	int numLoaded() const { return (int)tiles.size(); }
+	size_t getLoadedBytes() const { return loadedBytes; }
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <atomic>
+
+/*
+ * TripleBuffer hands whole values from one writer thread to one reader thread
+ * without either ever waiting on the other. The writer fills the back buffer and
+ * publishes it; the reader always gets the newest published value. Three buffers
+ * are enough for the writer to keep publishing while the reader holds one, so
+ * values the reader was too slow for are simply skipped.
+ */
+template <typename T>
+class TripleBuffer {
+private:
+	static const int FRESH = 4; // set on middle when it holds a value not yet read
+
+	T buffers[3];
+	int back = 0;                          // owned by the writer
+	int front = 1;                         // owned by the reader
+	alignas(64) std::atomic<int> middle{ 2 }; // the buffer passed between them
+public:
+	// The buffer to fill before publish(). It still holds an older value.
+	T& getBack() { return buffers[back]; }
+
+	void publish() {
+		back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & 3;
+	}
+
+	// The newest published value, or the one read last if nothing new was published
+	const T& read() {
+		if (middle.load(std::memory_order_relaxed) & FRESH) {
+			front = middle.exchange(front, std::memory_order_acq_rel) & 3;
+		}
+		return buffers[front];
+	}
+};
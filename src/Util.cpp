@@ -1,6 +1,7 @@
 // Kevin M.Smith - CS 134 SJSU
 
 #include "Util.h"
+#include <cstring>
 
 //---------------------------------------------------------------
 // test if a ray intersects a plane.  If there is an intersection, 
@@ -31,4 +32,96 @@ bool rayIntersectPlane(const ofVec3f& rayPoint, const ofVec3f& raydir, const ofV
 //
 ofVec3f reflectVector(const ofVec3f& v, const ofVec3f& n) {
 	return (v - 2 * v.dot(n) * n);
-}
\ No newline at end of file
+}
+
+// Read the submesh table of a mapped MeshPack file
+static void readParts(const MeshPackFile& file, vector<MeshPart>& partsRtn) {
+	partsRtn.clear();
+	for (uint32_t i = 0; i < file.header->numSubmeshes; i++) {
+		const MeshPackSubmesh& s = file.submeshes[i];
+		MeshPart part;
+		part.firstIndex = s.firstIndex;
+		part.numIndices = s.numIndices;
+		part.diffuse = ofFloatColor(s.diffuse[0], s.diffuse[1], s.diffuse[2], s.diffuse[3]);
+		part.ambient = ofFloatColor(s.ambient[0], s.ambient[1], s.ambient[2], s.ambient[3]);
+		part.specular = ofFloatColor(s.specular[0], s.specular[1], s.specular[2], s.specular[3]);
+		part.emissive = ofFloatColor(s.emissive[0], s.emissive[1], s.emissive[2], s.emissive[3]);
+		part.shininess = s.shininess;
+		part.texturePath = string(s.texturePath, strnlen(s.texturePath, sizeof(s.texturePath)));
+		partsRtn.push_back(part);
+	}
+}
+
+// Load a mesh baked by tools/meshpack into an ofMesh, with the parts it is drawn
+// in. The path is relative to the data folder, as are the parts' texture paths.
+// Touches no GL state, so it can run on a loader thread.
+//
+bool loadMeshPack(const string& path, ofMesh& mesh, vector<MeshPart>& partsRtn) {
+	MeshPackFile file;
+	if (!file.open(ofToDataPath(path))) return false;
+
+	const MeshPackHeader& header = *file.header;
+	mesh.clear();
+	mesh.setMode(OF_PRIMITIVE_TRIANGLES);
+
+	vector<glm::vec3>& vertices = mesh.getVertices();
+	vertices.resize(header.numVertices);
+	for (uint32_t i = 0; i < header.numVertices; i++) {
+		file.getPosition(i, &vertices[i].x);
+	}
+
+	if (file.normals != nullptr) {
+		vector<glm::vec3>& normals = mesh.getNormals();
+		normals.resize(header.numVertices);
+		for (uint32_t i = 0; i < header.numVertices; i++) {
+			const int8_t* n = &file.normals[4 * i];
+			normals[i] = glm::normalize(glm::vec3(n[0], n[1], n[2]));
+		}
+	}
+
+	if (file.texcoords != nullptr) {
+		vector<glm::vec2>& texCoords = mesh.getTexCoords();
+		texCoords.resize(header.numVertices);
+		for (uint32_t i = 0; i < header.numVertices; i++) {
+			texCoords[i] = glm::vec2(file.texcoords[2 * i], file.texcoords[2 * i + 1]);
+		}
+	}
+
+	vector<ofIndexType>& indices = mesh.getIndices();
+	indices.assign(file.indices, file.indices + header.numIndices);
+
+	readParts(file, partsRtn);
+	return true;
+}
+
+// Read only the parts of a packed mesh, for when its geometry comes from elsewhere
+bool loadMeshPackParts(const string& path, vector<MeshPart>& partsRtn) {
+	MeshPackFile file;
+	if (!file.open(ofToDataPath(path))) return false;
+	readParts(file, partsRtn);
+	return true;
+}
+
+ofMaterial makeMaterial(const MeshPart& part) {
+	ofMaterial material;
+	material.setDiffuseColor(part.diffuse);
+	material.setAmbientColor(part.ambient);
+	material.setSpecularColor(part.specular);
+	material.setEmissiveColor(part.emissive);
+	material.setShininess(part.shininess);
+	return material;
+}
+
+// FNV-1a hash of a mesh's vertices and indices, to tell whether two meshes are the same
+uint64_t hashMesh(const ofMesh& mesh) {
+	uint64_t hash = 14695981039346656037ULL;
+	auto add = [&hash](const void* data, size_t bytes) {
+		const unsigned char* p = (const unsigned char*)data;
+		for (size_t i = 0; i < bytes; i++) {
+			hash = (hash ^ p[i]) * 1099511628211ULL;
+		}
+	};
+	add(mesh.getVertices().data(), mesh.getNumVertices() * sizeof(glm::vec3));
+	add(mesh.getIndices().data(), mesh.getNumIndices() * sizeof(ofIndexType));
+	return hash;
+}
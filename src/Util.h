@@ -2,8 +2,28 @@
 //  Kevin M. Smith - CS 134 SJSU
 
 #include "ofMain.h"
+#include "MeshPack.h"
 
 bool rayIntersectPlane(const ofVec3f& rayPoint, const ofVec3f& raydir, ofVec3f const& planePoint,
 	const ofVec3f& planeNorm, ofVec3f& point);
 
-ofVec3f reflectVector(const ofVec3f& v, const ofVec3f& normal);
\ No newline at end of file
+ofVec3f reflectVector(const ofVec3f& v, const ofVec3f& normal);
+
+// A range of a packed mesh's triangles and the material it is drawn with
+struct MeshPart {
+	int firstIndex = 0;
+	int numIndices = 0;
+	// ofMaterial's defaults
+	ofFloatColor diffuse = ofFloatColor(0.8f, 0.8f, 0.8f);
+	ofFloatColor ambient = ofFloatColor(0.2f, 0.2f, 0.2f);
+	ofFloatColor specular = ofFloatColor(0, 0, 0);
+	ofFloatColor emissive = ofFloatColor(0, 0, 0);
+	float shininess = 0;
+	string texturePath; // relative to the data folder, may be empty
+};
+
+bool loadMeshPack(const string& path, ofMesh& mesh, vector<MeshPart>& partsRtn);
+bool loadMeshPackParts(const string& path, vector<MeshPart>& partsRtn);
+ofMaterial makeMaterial(const MeshPart& part);
+
+uint64_t hashMesh(const ofMesh& mesh);
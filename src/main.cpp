@@ -1,8 +1,68 @@
 #include "ofMain.h"
 #include "ofApp.h"
+#include "MonteCarlo.h"
+#include "LanderEnv.h"
+
+// Replay a recorded flight without opening a window, as fast as it runs, and
+// print the state it ends in
+static int replayHeadless(const string& path) {
+	FlightPlayer player;
+	if (!player.load(path)) return 1;
+
+	// Only a packed terrain can be loaded without a GL context. Packing quantizes
+	// the vertices, so a flight flown on the model itself never collided with the
+	// same terrain as its pack holds.
+	string terrainPath = player.header.terrainPath;
+	if (!ofIsStringInString(terrainPath, ".llmesh")) {
+		cout << "Error: " << path << " was flown on " << terrainPath << " rather than its packed version. "
+			<< "Only flights flown on a packed terrain replay headless, replay it without --headless" << endl;
+		return 1;
+	}
+	SimTerrain terrain;
+	if (!terrain.load(terrainPath)) return 1;
+	if (!player.checkTerrain(terrain.mesh)) return 1;
+
+	Simulation sim;
+	sim.bEffects = false;
+	sim.setTerrain(&terrain.octree, &terrain.heightfield);
+	player.begin(sim);
+
+	uint64_t start = ofGetElapsedTimeMicros();
+	while (player.step(sim)) {}
+	float seconds = (ofGetElapsedTimeMicros() - start) / 1e6f;
+
+	const char* states[] = { "LOADING", "PREGAME", "INGAME", "ENDGAME" };
+	cout << setprecision(9);
+	cout << "ticks:    " << sim.tick << " (" << sim.time << " s simulated in " << seconds << " s)" << endl;
+	cout << "state:    " << states[sim.state] << (sim.shipExploded ? ", exploded" : "") << endl;
+	cout << "position: " << sim.lander.position.x << " " << sim.lander.position.y << " " << sim.lander.position.z << endl;
+	cout << "velocity: " << sim.lander.velocity.x << " " << sim.lander.velocity.y << " " << sim.lander.velocity.z << endl;
+	cout << "rotation: " << sim.lander.rotation << endl;
+	cout << "fuel:     " << sim.fuel << endl;
+	cout << "score:    " << sim.score << endl;
+	return 0;
+}
 
 //========================================================================
-int main( ){
+int main(int argc, char** argv){
+
+	// lunar-lander [--replay <flight.llrec> [--speed <x>] [--headless]]
+	//              [--montecarlo <options>] [--env-benchmark <options>]
+	string replayPath;
+	float replaySpeed = 1.0f;
+	bool bHeadless = false;
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		if (arg == "--replay" && i + 1 < argc) replayPath = argv[++i];
+		else if (arg == "--speed" && i + 1 < argc) replaySpeed = ofToFloat(argv[++i]);
+		else if (arg == "--headless") bHeadless = true;
+		else if (arg == "--montecarlo") return runMonteCarlo(argc, argv);
+		else if (arg == "--env-benchmark") return runEnvBenchmark(argc, argv);
+	}
+
+	if (bHeadless && !replayPath.empty()) {
+		return replayHeadless(replayPath);
+	}
 
 	//Use ofGLFWWindowSettings for more options like multi-monitor fullscreen
 	ofGLWindowSettings settings;
@@ -11,7 +71,11 @@ int main( ){
 
 	auto window = ofCreateWindow(settings);
 
-	ofRunApp(window, make_shared<ofApp>());
+	auto app = make_shared<ofApp>();
+	app->replayPath = replayPath;
+	app->replaySpeed = replaySpeed;
+
+	ofRunApp(window, app);
 	ofRunMainLoop();
 
 }
@@ -24,20 +24,36 @@ glm::vec3 ofApp::getMousePointOnPlane(glm::vec3 planePt, glm::vec3 planeNorm) {
 }
 
 void ofApp::setupLander() {
-	lander = new LunarLander();
-
 	string modelPath = "geo/lander.obj";
 
 	if (gameEnv == DESERT) {
 		modelPath = "geo/ufo_lander.fbx";
 	}
 
+	// A lander packed by tools/meshpack is drawn from the pack, without Assimp
+	string packPath = modelPath + ".llmesh";
+	if (ofFile::doesFileExist(packPath)) {
+		if (!landerPack.load(packPath)) {
+			cout << "Error: Can't load mesh " << packPath << endl;
+			ofExit(0);
+		}
+		landerPack.setScale(.5);
+		bLanderPacked = true;
+
+		sim.landerMin = landerPack.getSceneMin();
+		sim.landerMax = landerPack.getSceneMax();
+		return;
+	}
+
 	// load lander model
-	if (lander->model.loadModel(modelPath)) {
-		lander->model.setScaleNormalization(false);
-		lander->model.setScale(.5, .5, .5);
-		lander->model.setRotation(0, 0, 1, 0, 0);
-		lander->setPosition(ofVec3f(0, 15.0f, 0));
+	if (landerModel.loadModel(modelPath)) {
+		landerModel.setScaleNormalization(false);
+		landerModel.setScale(.5, .5, .5);
+		landerModel.setRotation(0, 0, 1, 0, 0);
+
+		// The simulation only needs the model's extent
+		sim.landerMin = landerModel.getSceneMin();
+		sim.landerMax = landerModel.getSceneMax();
 	}
 	else {
 		cout << "Error: Can't load model " << modelPath << endl;
@@ -48,22 +64,27 @@ void ofApp::setupLander() {
 /* Finds the altitude of the lander(distance between the landerand the terrain)
  * by using ray-based collision detection with the terrain. */
 float ofApp::computeAGL() {
-	ofVec3f pos = lander->getPosition();
+	ofVec3f pos = sim.lander.getPosition();
 	ofVec3f rayDirection = ofVec3f(0, -1, 0);
 
 	// Create ray from lander towards terrain
-	Ray ray = Ray(
-		Vector3(pos.x, pos.y, pos.z), 
-		Vector3(rayDirection.x, rayDirection.y, rayDirection.z)
-	);
+	Ray ray = Ray(pos, rayDirection);
+
+	if (bStreaming) {
+		glm::vec3 point;
+		if (terrainStreamer.intersect(ray, point)) {
+			return pos.y - point.y;
+		}
+		return 0;
+	}
 
 	// Detect which node the ray collides with
-	TreeNode node;
+	NodeHandle node;
 	bool nodeFound = octree.intersect(ray, octree.root, node);
 
 	if (nodeFound) {
 		// Compute distance between lander position and point on terrain
-		ofVec3f nodePos = octree.mesh.getVertex(node.points[0]);
+		const glm::vec3& nodePos = octree.getVertex(node.getPoint(0));
 
 		return pos.y - nodePos.y;
 	}
@@ -71,34 +92,100 @@ float ofApp::computeAGL() {
 	return 0;
 }
 
-// Load vertex buffer in preparation for rendering
-void ofApp::loadVbo() {
-	if (emitter->sys->particles.size() < 1 && explosionEmitter->sys->particles.size() < 1) {
-		return;
+// Sample the flight controls into the simulation's input bits
+uint32_t ofApp::getInput() {
+	uint32_t input = 0;
+	if (keymap['w']) input |= INPUT_THRUST_UP;
+	if (keymap['s']) input |= INPUT_THRUST_DOWN;
+	if (keymap['a']) input |= INPUT_ROTATE_LEFT;
+	if (keymap['d']) input |= INPUT_ROTATE_RIGHT;
+	if (keymap[OF_KEY_UP]) input |= INPUT_FORWARD;
+	if (keymap[OF_KEY_DOWN]) input |= INPUT_BACKWARD;
+	if (keymap[OF_KEY_LEFT]) input |= INPUT_LEFT;
+	if (keymap[OF_KEY_RIGHT]) input |= INPUT_RIGHT;
+	return input;
+}
+
+// Start the flight with a fresh seed, recording it if enabled
+void ofApp::startFlight() {
+	uint64_t seed = ofGetSystemTimeMicros();
+	// Streamed tiles come and go with the frame rate, so such flights can't be replayed
+	if (bRecordFlights && !bStreaming) {
+		recorder.begin(sim, seed, bTerrainPacked ? terrainPath + ".llmesh" : terrainPath, terrainHash);
 	}
+	sim.start(seed);
+	flightStartTick = sim.tick;
+	rewindRing.clear();
+	sim.save(rewindRing.push()); // so a rewind can go all the way back to the start
+
+	if (bTelemetry) {
+		ofDirectory::createDirectory("telemetry", true, true);
+		telemetryPath = ofToDataPath("telemetry/flight-" + ofGetTimestampString() + ".lltm");
+		telemetry.open(telemetryPath);
+		telemetryVelocity = sim.lander.velocity;
+	}
+}
+
+// Write out the recording of the flight that just ended
+void ofApp::endFlight() {
+	telemetry.close();
 
-	vector<ofVec3f> sizes;
-	vector<ofVec3f> points;
-	for (int i = 0; i < emitter->sys->particles.size(); i++) {
-		points.push_back(emitter->sys->particles[i].position);
-		sizes.push_back(ofVec3f(emitter->particleRadius));
+	if (!recorder.isRecording()) return;
+
+	ofDirectory::createDirectory("recordings", true, true);
+	string path = ofToDataPath("recordings/flight-" + ofGetTimestampString() + ".llrec");
+	if (recorder.save(path)) {
+		cout << "Flight recorded to " << path << endl;
 	}
+}
 
-	for (int i = 0; i < explosionEmitter->sys->particles.size(); i++) {
-		points.push_back(explosionEmitter->sys->particles[i].position);
-		sizes.push_back(ofVec3f(explosionEmitter->particleRadius));
+// Hand the state after the last tick to the telemetry writer
+void ofApp::logTelemetry(uint32_t input) {
+	if (!telemetry.isOpen()) return;
+
+	const LunarLander& lander = sim.lander;
+	ofVec3f acceleration = (lander.velocity - telemetryVelocity) / sim.dt;
+	ofVec3f thrust = sim.thrustForce.getThrust();
+	telemetryVelocity = lander.velocity;
+
+	TelemetrySample sample;
+	sample.tick = sim.tick;
+	sample.time = sim.time;
+	for (int k = 0; k < 3; k++) {
+		sample.position[k] = lander.position[k];
+		sample.velocity[k] = lander.velocity[k];
+		sample.acceleration[k] = acceleration[k];
+		sample.thrust[k] = thrust[k];
 	}
+	sample.rotation = lander.rotation;
+	sample.angularVelocity = lander.angularVelocity;
+	sample.torque = sim.tanForce.getTorque().y;
+	sample.fuel = sim.fuel;
+	sample.agl = sim.getAGL();
+	sample.slope = sensors.readings.size() > 0 ? sensors.readings[sensors.getSlopeOffset()] : 0;
+	sample.impactSpeed = sim.impactSpeed;
+	sample.input = input;
+	sample.events = sim.events;
+	sample.numCollisions = (uint32_t)sim.collisionBoxes.size();
+	sample.state = (uint8_t)sim.state;
+	telemetry.log(sample);
+}
 
-	// Upload data to the vbo
-	int total = (int)points.size();
-	vbo.clear();
-	vbo.setVertexData(&points[0], total, GL_STATIC_DRAW);
-	vbo.setNormalData(&sizes[0], total, GL_STATIC_DRAW);
+// Collect the particles of both systems, as the simulation thread gathered them, for rendering
+void ofApp::loadParticles() {
+	particleRenderer.clear();
+	particleRenderer.add(frame->particles);
+	if (bAlphaParticles) {
+		// ofCamera looks down its negative z axis
+		particleRenderer.sortByDepth(theCam->getPosition(), -theCam->getZAxis());
+	}
+	particleRenderer.upload();
 }
 
 //--------------------------------------------------------------
 void ofApp::setup(){
 	ofSetFrameRate(60);
+	frame = &simFrames.read();
 
 	bDisplayPoints = false;
 	bAltKeyDown = false;
@@ -108,117 +195,227 @@ void ofApp::setup(){
 	ofEnableSmoothing();
 	ofEnableDepthTest();
 
-	bBackgroundLoaded = backgroundImage.load("images/starfield-plain.jpg");
-
-	// Load custom font
-	textDisplay.load("fonts/LucidaConsole.ttf", 16);
-
 	// Set up basic lighting
 	initLightingAndMaterials();
 
-	// Load terrain
-	string terrainPath = "geo/moon-houdini.obj";
-	if (gameEnv == DESERT) {
-		terrainPath = "geo/terrain.fbx";
+	// Particle textures are addressed with normalized coordinates
+	ofDisableArbTex();
 
-		// Change landing areas for the Desert terrain
-		landingArea1 = ofVec3f(42.5, -0.9, 15.5);
-		landingArea2 = ofVec3f(28.2, 6.0, 81.7);
-		landingArea3 = ofVec3f(-106.7, 34.5, 29.7);
+	// Load terrain
+	terrainPath = Simulation::getTerrainPath(gameEnv);
+	sim.setEnvironment(gameEnv);
+
+	// Everything below is loaded while the progress screen is shown. Image decoding
+	// and the octree build run on worker threads; model, shader, font and sound
+	// loading touch GL or the sound system and run on the main thread in between.
+	sim.state = LOADING;
+
+	loader.addTask("Decoding background",
+		[this] { bBackgroundLoaded = ofLoadImage(backgroundPixels, "images/starfield-plain.jpg"); },
+		[this] { if (bBackgroundLoaded) backgroundImage.setFromPixels(backgroundPixels); });
+
+	loader.addTask("Decoding particle texture",
+		[this] { bParticlePixelsLoaded = ofLoadImage(particlePixels, "images/dot.png"); },
+		[this] {
+			if (!bParticlePixelsLoaded) {
+				cout << "Error: Can't load texture file: images/dot.png not found" << endl;
+				ofExit(0);
+			}
+			particleTexture.loadData(particlePixels);
+		});
+
+	// Baked terrain tiles are streamed instead of loading the whole terrain
+	string tilesPath = terrainPath + ".tiles";
+	bool bTilesBaked = bStreamTerrain && ofDirectory::doesDirectoryExist(tilesPath);
+
+	// A terrain packed by tools/meshpack is mapped straight into memory, which
+	// keeps Assimp and its post-processing off the start-up path
+	string packPath = terrainPath + ".llmesh";
+	bTerrainPacked = ofFile::doesFileExist(packPath);
+
+	if (bTilesBaked) {
+		// The tiles carry no material, the terrain's pack does
+		loader.addTask("Opening terrain tiles",
+			[this, packPath] {
+				vector<MeshPart> parts;
+				if (bTerrainPacked && loadMeshPackParts(packPath, parts) && parts.size() > 0) {
+					terrainPart = parts[0];
+					if (!terrainPart.texturePath.empty()) {
+						ofLoadImage(terrainTexturePixels, terrainPart.texturePath);
+					}
+				}
+			},
+			[this, tilesPath] {
+				if (!bTerrainPacked) {
+					cout << "Terrain tiles are drawn untextured, pack " << terrainPath << " with tools/meshpack to texture them" << endl;
+				}
+				loadTerrainMaterial();
+				openTerrainTiles(tilesPath);
+			});
 	}
-	if (terrain.loadModel(terrainPath)) {
-		terrain.setScaleNormalization(false);
+	else if (bTerrainPacked) {
+		loader.addTask("Loading terrain",
+			[this, packPath] {
+				vector<MeshPart> parts;
+				bTerrainPackOk = loadMeshPack(packPath, terrainMesh, parts);
+				if (bTerrainPackOk && parts.size() > 0) {
+					terrainPart = parts[0];
+					if (!terrainPart.texturePath.empty()) {
+						ofLoadImage(terrainTexturePixels, terrainPart.texturePath);
+					}
+				}
+			},
+			[this, packPath, tilesPath] {
+				if (!bTerrainPackOk) {
+					cout << "Error: Can't load mesh " << packPath << endl;
+					ofExit(0);
+				}
+				buildTerrain(tilesPath);
+			});
 	}
 	else {
-		cout << "Error: Can't load model " << terrainPath << endl;
-		ofExit(0);
+		loader.addMainTask("Loading terrain", [this, tilesPath] {
+			if (terrain.loadModel(terrainPath)) {
+				terrain.setScaleNormalization(false);
+			}
+			else {
+				cout << "Error: Can't load model " << terrainPath << endl;
+				ofExit(0);
+			}
+			terrainMesh = terrain.getMesh(0);
+			buildTerrain(tilesPath);
+		});
 	}
 
-	// Particle shaders & texture
+	loader.addMainTask("Loading lander", [this] { setupLander(); });
 
-	ofDisableArbTex();
+	loader.addMainTask("Loading font", [this] {
+		// Load custom font
+		textDisplay.load("fonts/LucidaConsole.ttf", 16);
+	});
 
-	// Load particle textures and shaders
-	if (!ofLoadImage(particleTexture, "images/dot.png")) {
-		cout << "Error: Can't load texture file: images/dot.png not found" << endl;
-		ofExit(0);
+	loader.addMainTask("Loading shaders", [this] {
+		if (!particleRenderer.setup()) {
+			ofExit(0);
+		}
+	});
+
+	// Load sounds
+	loader.addMainTask("Loading sounds", [this] {
+		if (!explosionSound.load("sounds/explosion.mp3")) {
+			cout << "Error: Can't load sound file: sounds/explosion.mp3" << endl;
+			ofExit(0);
+		}
+		explosionSound.setSpeed(0.8);
+	});
+
+	loader.addMainTask("Loading sounds", [this] {
+		if (!thrustSound.load("sounds/thrust.mp3")) {
+			cout << "Error: Can't load sound file: sounds/thrust.mp3" << endl;
+			ofExit(0);
+		}
+		thrustSound.setVolume(0.75);
+	});
+
+	loader.addMainTask("Loading sounds", [this] {
+		if (!dingSound.load("sounds/ding.mp3")) {
+			cout << "Error: Can't load sound file: sounds/ding.mp3" << endl;
+			ofExit(0);
+		}
+		dingSound.setVolume(0.4);
+	});
+
+	loader.start(thread::hardware_concurrency() > 1 ? thread::hardware_concurrency() - 1 : 1);
+}
+
+// Queue the rest of the terrain set-up once terrainMesh holds the terrain
+void ofApp::buildTerrain(const string& tilesPath) {
+	if (bStreamTerrain) {
+		// Cut the terrain into tiles on the first run
+		loader.addTask("Baking terrain tiles",
+			[this, tilesPath] { bTilesBakeOk = TerrainStreamer::bake(terrainMesh, tilesPath, 64.0f); },
+			[this, tilesPath] {
+				if (!bTilesBakeOk) ofExit(0);
+				loadTerrainMaterial();
+				terrainMesh.clear();
+				terrain.clear();
+				openTerrainTiles(tilesPath);
+			});
+		return;
 	}
 
-#ifdef TARGET_OPENGLES
-	if (!shader.load("shaders_gles/shader")) {
-		cout << "Error: Can't load shader file: shaders_gles/shader not found" << endl;
-		ofExit(0);
+	// Create Octree over the one copy of the terrain mesh that is kept around,
+	// and split the terrain into view-culled chunks along it
+	loader.addTask("Building octree",
+		[this] {
+			octree.create(terrainMesh, 20);
+			terrainHeightfield.create(octree, 0.5f);
+			terrainRenderer.build(terrainMesh, octree, 3);
+		},
+		[this] {
+			terrainRenderer.upload();
+			loadTerrainMaterial();
+			terrainRenderer.setMaterial(terrainMaterial);
+			terrainRenderer.setTexture(terrainTexture);
+
+			// The renderer and the octree now hold everything they need, so free
+			// the loader's own copy of the terrain
+			terrain.clear();
+		});
+}
+
+// Take the terrain's material and texture from its pack or from the Assimp model,
+// whichever was loaded. Runs on the main thread.
+void ofApp::loadTerrainMaterial() {
+	if (bTerrainPacked) {
+		terrainMaterial = makeMaterial(terrainPart);
+		if (terrainTexturePixels.isAllocated()) {
+			terrainTexture.loadData(terrainTexturePixels);
+			terrainTexturePixels.clear();
+		}
 	}
-#else
-	if (!shader.load("shaders/shader")) {
-		cout << "Error: Can't load shader file: shaders/shader not found" << endl;
-		ofExit(0);
+	else if (terrain.getNumMeshes() > 0) {
+		terrainMaterial = terrain.getMaterialForMesh(0);
+		terrainTexture = terrain.getTextureForMesh(0);
 	}
-#endif
+}
 
-	// Load sounds
-	if (!explosionSound.load("sounds/explosion.mp3")) {
-		cout << "Error: Can't load sound file: sounds/explosion.mp3" << endl;
+void ofApp::openTerrainTiles(const string& tilesPath) {
+	terrainStreamer.memoryBudget = terrainMemoryBudget;
+	if (!terrainStreamer.open(tilesPath)) {
 		ofExit(0);
 	}
-	explosionSound.setSpeed(0.8);
+	terrainStreamer.setMaterial(terrainMaterial);
+	terrainStreamer.setTexture(terrainTexture);
+	bStreaming = true;
 
-	if (!thrustSound.load("sounds/thrust.mp3")) {
-		cout << "Error: Can't load sound file: sounds/thrust.mp3" << endl;
-		ofExit(0);
-	}
-	thrustSound.setVolume(0.75);
+	// There is no whole-terrain octree or heightfield to run these against, and
+	// which tiles a flight collided with depends on how fast they were paged in
+	cout << "Streaming terrain: particles don't collide with it, the sensors are off and flights are not recorded" << endl;
+}
 
-	if (!dingSound.load("sounds/ding.mp3")) {
-		cout << "Error: Can't load sound file: sounds/ding.mp3" << endl;
-		ofExit(0);
+// Set up everything that needs the loaded assets. Runs once loading has finished.
+void ofApp::setupScene() {
+	// Hand the terrain to the simulation
+	if (bStreaming) {
+		sim.setTerrain(&octree, &terrainHeightfield, &terrainStreamer);
+	}
+	else {
+		sim.setTerrain(&octree, &terrainHeightfield);
+		terrainHash = hashMesh(terrainMesh);
 	}
-	dingSound.setVolume(0.4);
-	
-	// Create Octree
-	octree.create(terrain.getMesh(0), 20);
-
-	setupLander();
-
-	// Set up forces
-	thrustForce = new ThrustForce(ofVec3f(0, 0, 0));
-	tanForce = new TangentialForce(ofVec3f(0, 0, 0));
-	particleForce = new ThrustForce(ofVec3f(0, -particleThrust, 0));
-	turbForce = new TurbulenceForce(
-		ofVec3f(-2.0f, -2.0f, -2.0f),
-		ofVec3f(2.0f, 2.0f, 2.0f)
-	);
-	gravityForce = new GravityForce(gravity);
-
-	// Set up particle system
-	particleSys = new ParticleSystem();
-	emitter = new ParticleEmitter(particleSys);
-
-	emitter->sys->addForce(particleForce);
-	emitter->sys->addForce(turbForce);
-	emitter->sys->addForce(gravityForce);
-	emitter->radius = 0.2f;
-	emitter->rate = 45.0f;
-	emitter->particleRadius = 3.0f;
-	emitter->lifespan = 0.5f;
-	emitter->groupSize = 50;
-	emitter->particleVelocity = ofVec3f(0, -0.8f, 0);
-
-	// Set up explosion particle system
-	explosionForce = new ImpulseRadialForce(explosionMagnitude);
-	explosionForce->applyOnce = true;
-
-	explosionParticleSys = new ParticleSystem();
-	explosionEmitter = new ParticleEmitter(explosionParticleSys);
-
-	explosionEmitter->sys->addForce(explosionForce);
-
-	explosionEmitter->type = RadialEmitter;
-	explosionEmitter->particleRadius = 9.0f;
-	explosionEmitter->lifespan = 4.0f;
-	explosionEmitter->groupSize = 1300;
-	explosionEmitter->particleVelocity = ofVec3f(0, 0, 0);
-	explosionEmitter->oneShot = true;
+	sim.reset(ofGetSystemTimeMicros());
+
+	// The main and simulation threads have cores of their own
+	jobs.start(thread::hardware_concurrency() > 2 ? thread::hardware_concurrency() - 2 : 1);
+	sim.setJobs(&jobs);
+	autopilot.jobs = &jobs;
+	autopilot.sensors = &sensors;
+	particleRenderer.jobs = &jobs;
+
+	// Rewinding only needs the flight, the particle effects carry on as they are
+	rewindRing.setup((int)(rewindSeconds / sim.dt));
+	sensors.setup();
 
 	// Set up lighting
 	ambientLight.setup();
@@ -242,9 +439,9 @@ void ofApp::setup(){
 	landingArea1Light.setDiffuseColor(ofColor::lightBlue);
 	landingArea1Light.setSpecularColor(ofFloatColor(1, 1, 1));
 	landingArea1Light.rotate(-90, ofVec3f(1, 0, 0));
-	landingArea1Light.setPosition(landingArea1 + ofVec3f(0, lightDistance, 0));
+	landingArea1Light.setPosition(sim.landingAreas[0] + ofVec3f(0, lightDistance, 0));
 	if (gameEnv == DESERT) {
-		landingArea1Light.setPosition(landingArea1 + ofVec3f(0, 5.0, 0));
+		landingArea1Light.setPosition(sim.landingAreas[0] + ofVec3f(0, 5.0, 0));
 	}
 
 	landingArea2Light.setup();
@@ -257,9 +454,9 @@ void ofApp::setup(){
 	landingArea2Light.setDiffuseColor(ofColor::lightBlue);
 	landingArea2Light.setSpecularColor(ofFloatColor(1, 1, 1));
 	landingArea2Light.rotate(-90, ofVec3f(1, 0, 0));
-	landingArea2Light.setPosition(landingArea2 + ofVec3f(0, lightDistance, 0));
+	landingArea2Light.setPosition(sim.landingAreas[1] + ofVec3f(0, lightDistance, 0));
 	if (gameEnv == DESERT) {
-		landingArea2Light.setPosition(landingArea2 + ofVec3f(0, 4.0, 0));
+		landingArea2Light.setPosition(sim.landingAreas[1] + ofVec3f(0, 4.0, 0));
 	}
 
 	landingArea3Light.setup();
@@ -272,9 +469,9 @@ void ofApp::setup(){
 	landingArea3Light.setDiffuseColor(ofColor::lightBlue);
 	landingArea3Light.setSpecularColor(ofFloatColor(1, 1, 1));
 	landingArea3Light.rotate(-90, ofVec3f(1, 0, 0));
-	landingArea3Light.setPosition(landingArea3 + ofVec3f(0, lightDistance, 0));
+	landingArea3Light.setPosition(sim.landingAreas[2] + ofVec3f(0, lightDistance, 0));
 	if (gameEnv == DESERT) {
-		landingArea3Light.setPosition(landingArea3 + ofVec3f(0, 0.3, 0));
+		landingArea3Light.setPosition(sim.landingAreas[2] + ofVec3f(0, 0.3, 0));
 	}
 
 	landerLight.setup();
@@ -285,10 +482,10 @@ void ofApp::setup(){
 	landerLight.setAmbientColor(ofFloatColor(0.1, 0.1, 0.1));
 	landerLight.setSpecularColor(ofFloatColor(1, 1, 1));
 	landerLight.rotate(-90, ofVec3f(1, 0, 0));
-	landerLight.setPosition(lander->getPosition());
+	landerLight.setPosition(sim.lander.getPosition());
 
 	// Set up cameras
-	freeCam.setTarget(lander->getPosition());
+	freeCam.setTarget(sim.lander.getPosition());
 	freeCam.setDistance(10);
 	freeCam.setNearClip(.1);
 	freeCam.setFov(65.5);   // approx equivalent to 28mm in 35mm format
@@ -300,14 +497,14 @@ void ofApp::setup(){
 	topCam.lookAt(glm::vec3(0, 0, 0));
 
 	trackingCam.setPosition(ofVec3f(20, 24, -15));
-	trackingCam.setTarget(lander->getPosition());
+	trackingCam.setTarget(sim.lander.getPosition());
 	trackingCam.setDistance(10);
 	trackingCam.setNearClip(0.1);
 	trackingCam.setFov(65.5);
 	trackingCam.disableMouseInput();
 
-	onboardCam.setPosition(lander->getPosition());
-	onboardCam.setTarget(lander->getPosition() + lander->getForwardUV());
+	onboardCam.setPosition(sim.lander.getPosition());
+	onboardCam.setTarget(sim.lander.getPosition() + sim.lander.getForwardUV());
 	onboardCam.setDistance(10);
 	onboardCam.setNearClip(0.1);
 	onboardCam.setFov(65.5);
@@ -318,170 +515,269 @@ void ofApp::setup(){
 
 //--------------------------------------------------------------
 void ofApp::update(){
-	if (score == 30) {
-		gamestate = ENDGAME;
+	frame = &simFrames.read();
+	if (frame->state == LOADING) {
+		if (loader.update()) {
+			setupScene();
+			sim.state = PREGAME;
+
+			if (!replayPath.empty() && player.load(replayPath)) {
+				if (bStreaming) {
+					cout << "Error: Flights can't be replayed on streamed terrain, set bStreamTerrain to false" << endl;
+				}
+				else if (player.checkTerrain(terrainMesh)) {
+					player.begin(sim);
+					bReplaying = true;
+				}
+			}
+			simReplaySpeed = replaySpeed;
+
+			// From here on only the simulation thread touches sim
+			simCommands.setup(256);
+			publishFrame();
+			frame = &simFrames.read();
+			simThread = thread(&ofApp::simThreadedFunction, this);
+		}
+		return;
 	}
 
-	// Apply rotational forces
-	tanForce->setTorque(ofVec3f(0, 0, 0));
-	if (keymap['a']) {
-		tanForce->setTorque(
-			tanForce->getTorque() + ofVec3f(0, -torqueMagnitude, 0)
-		);
-		emitter->start();
+	// Answer the simulation's events with sound and light
+	uint32_t events = simEvents.exchange(0);
+	if (frame->state == INGAME && frame->bThrusting) {
+		if (!thrustSound.isPlaying()) {
+			thrustSound.play();
+		}
 	}
-	if (keymap['d']) {
-		tanForce->setTorque(
-			tanForce->getTorque() + ofVec3f(0, torqueMagnitude, 0)
-		);
-		emitter->start();
+	else {
+		thrustSound.stop();
 	}
-
-	// Apply directional (thruster) forces
-	thrustForce->setThrust(ofVec3f(0, 0, 0));
-	if (keymap['w']) {
-		thrustForce->setThrust(
-			thrustForce->getThrust() + ofVec3f(0, thrustMagnitude, 0)
-		);
-		emitter->start();
+	if (events & EVENT_EXPLODED) {
+		explosionSound.play();
 	}
-	if (keymap['s']) {
-		thrustForce->setThrust(
-			thrustForce->getThrust() + ofVec3f(0, -thrustMagnitude, 0)
-		);
-		emitter->start();
+	if (events & EVENT_LANDED) {
+		dingSound.play();
 	}
-	if (keymap[OF_KEY_UP]) {
-		thrustForce->setThrust(
-			thrustForce->getThrust() + (thrustMagnitude * lander->getForwardUV())
-		);
-		emitter->start();
+	ofLight* areaLights[3] = { &landingArea1Light, &landingArea2Light, &landingArea3Light };
+	for (int i = 0; i < 3; i++) {
+		areaLights[i]->setDiffuseColor(frame->areaLanded[i] ? ofColor::green : ofColor::lightBlue);
 	}
-	if (keymap[OF_KEY_DOWN]) {
-		thrustForce->setThrust(
-			thrustForce->getThrust() + (thrustMagnitude * lander->getBackwardUV())
-		);
-		emitter->start();
+
+	// Move the model to the simulated lander
+	ofVec3f landerPos = frame->landerPosition;
+	if (bLanderPacked) {
+		landerPack.setPosition(landerPos.x, landerPos.y, landerPos.z);
+		landerPack.setRotation(frame->landerRotation);
 	}
-	if (keymap[OF_KEY_LEFT]) {
-		thrustForce->setThrust(
-			thrustForce->getThrust() + (thrustMagnitude * lander->getLeftUV())
-		);
-		emitter->start();
+	else {
+		landerModel.setPosition(landerPos.x, landerPos.y, landerPos.z);
+		landerModel.setRotation(1, frame->landerRotation, 0, 1, 0);
 	}
-	if (keymap[OF_KEY_RIGHT]) {
-		thrustForce->setThrust(
-			thrustForce->getThrust() + (thrustMagnitude * lander->getRightUV())
-		);
-		emitter->start();
+
+	landerLight.setPosition(landerPos);
+
+	// Update cameras
+	trackingCam.lookAt(landerPos);
+	onboardCam.setPosition(landerPos);
+	onboardCam.setTarget(landerPos + frame->landerForward);
+
+	// Page terrain tiles in and out around the lander
+	if (bStreaming) {
+		terrainStreamer.update(landerPos);
 	}
+}
+
+/* simThreadedFunction() steps the simulation at its fixed rate, catching up on the
+ * time since it last woke, and publishes a frame after every batch of ticks. A
+ * replay runs through its ticks simReplaySpeed times as fast. */
+void ofApp::simThreadedFunction() {
+	typedef chrono::steady_clock Clock;
+	Clock::duration tickTime = chrono::duration_cast<Clock::duration>(chrono::duration<double>(sim.dt));
+	Clock::time_point last = Clock::now();
+	Clock::time_point wake = last;
+	double accumulator = 0;
+
+	while (!bStopSim) {
+		bool bChanged = false;
+		SimCommand command;
+		while (simCommands.pop(command)) {
+			runCommand(command);
+			bChanged = true;
+		}
+
+		Clock::time_point now = Clock::now();
+		accumulator += chrono::duration<double>(now - last).count() * (bReplaying ? simReplaySpeed : 1.0f);
+		last = now;
+
+		int steps = 0;
+		if (accumulator >= sim.dt) {
+			ProfileScope scope("simulation");
+			while (accumulator >= sim.dt && steps < maxCatchUpSteps) {
+				stepSimulation();
+				accumulator -= sim.dt;
+				steps++;
+			}
+		}
+		if (steps == maxCatchUpSteps) {
+			accumulator = 0;
+		}
+		if (steps > 0 || bChanged) {
+			publishFrame();
+		}
 
-	// Apply forces on the lander
-	if (gamestate == INGAME) {
-		thrustForce->update(lander);
-		tanForce->update(lander);
+		// Sleep until the next tick is due. After a stall the accumulator makes up
+		// the ticks, so the missed wake-ups are skipped rather than rushed through.
+		wake += tickTime;
+		if (wake < now) wake = now;
+		this_thread::sleep_until(wake);
+	}
+}
 
-		if (fuel <= 0) {
-			gamestate = ENDGAME;
+// Carry out a request from the main thread
+void ofApp::runCommand(const SimCommand& command) {
+	switch (command.type) {
+	case SimStartFlight:
+		if (sim.state == PREGAME && !bReplaying) {
+			startFlight();
+		}
+		break;
+	case SimResetFlight:
+		if (sim.state != PREGAME) {
+			// Reset lander and emitter positions, and variables
+			endFlight();
+			sim.reset(ofGetSystemTimeMicros());
+			rewindRing.clear();
+		}
+		break;
+	case SimRewind:
+		if (command.value != 0) {
+			if (sim.state != PREGAME) bRewinding = true;
 		}
 		else {
-			// Reduce fuel if thrusters are being used
-			float thrustMagnitude = thrustForce->getThrust().length();
-			float tanMagnitude = tanForce->getTorque().length();
-			if (thrustMagnitude != 0 || tanMagnitude != 0) {
-				float dt = 1.0f / ofGetFrameRate();
-				fuel -= dt;
-
-				// Play thrust sound
-				if (!thrustSound.isPlaying()) {
-					thrustSound.play();
-				}
-			}
-			else {
-				thrustSound.stop();
-			}
+			bRewinding = false;
+			autopilot.begin(sim);
+		}
+		break;
+	case SimToggleAutopilot:
+		// Start the autopilot on a fresh plan from wherever the lander is
+		bAutopilot = !bAutopilot;
+		autopilot.begin(sim);
+		break;
+	case SimRestartReplay:
+		player.begin(sim);
+		break;
+	case SimReplaySpeed:
+		simReplaySpeed = command.value;
+		break;
+	case SimMoveLander:
+		if (sim.state == PREGAME) {
+			sim.lander.setPosition(sim.lander.getPosition() + command.offset);
+			sim.getCollisionBoxes(sim.lander.getBounds(0.5f), sim.collisionBoxes);
+		}
+		break;
+	}
+}
+
+// Advance one tick, flown by the player, the autopilot, a replay or a rewind
+void ofApp::stepSimulation() {
+	GameState lastState = sim.state;
+	uint32_t input = 0;
+	if (bReplaying) {
+		if (!player.step(sim)) sim.step(0);
+	}
+	else if (bRewinding) {
+		// Step back one tick and forget what was recorded after it
+		if (!rewindRing.isEmpty()) {
+			sim.restore(rewindRing.back());
+			rewindRing.pop();
+			recorder.rewind((uint32_t)(sim.tick - flightStartTick));
+		}
+
+		// Back into a flight that had ended: carry on with its telemetry log
+		if (lastState != INGAME && sim.state == INGAME && bTelemetry) {
+			telemetry.open(telemetryPath, true);
 		}
 	}
 	else {
-		emitter->stop();
+		input = bAutopilot ? autopilot.update(sim) : keyInput.load();
+		if (sim.state == INGAME) recorder.record(input);
+		sim.step(input);
+		if (sim.state != PREGAME) sim.save(rewindRing.push());
 	}
-	if (gamestate != PREGAME) {
-		turbForce->update(lander);
-		gravityForce->update(lander);
-		lander->integrate();
+	if (!bStreaming && sim.state == INGAME) {
+		sensors.scan(sim, octree);
 	}
+	if (lastState == INGAME && !bReplaying && !bRewinding) {
+		logTelemetry(input);
+	}
+	else if (bRewinding) {
+		telemetryVelocity = sim.lander.velocity;
+	}
+	simEvents |= sim.events;
 
-	emitter->position = lander->getPosition();
-	emitter->update();
-
-	landerLight.setPosition(lander->getPosition());
+	if (lastState == INGAME && sim.state != INGAME) {
+		endFlight();
+	}
+}
 
-	// Update cameras
-	trackingCam.lookAt(lander->getPosition());
-	onboardCam.setPosition(lander->getPosition());
-	onboardCam.setTarget(lander->getPosition() + lander->getForwardUV());
-
-	explosionEmitter->update();
-
-	// Compute lander bounds
-	ofVec3f min = lander->model.getSceneMin() + lander->getPosition();
-	ofVec3f max = lander->model.getSceneMax() + lander->getPosition();
-	Box bounds = Box(Vector3(min.x, min.y, min.z), Vector3(max.x, max.y, max.z));
-
-	// Update collision boxes
-	colBoxList.clear();
-	octree.intersect(bounds, octree.root, colBoxList);
-
-	// Handle lander collision with the terrain
-	if (gamestate != PREGAME && colBoxList.size() >= 10) {
-		// Apply impulse to the lander upon collision
-		ofVec3f yNormal = ofVec3f(0, 1, 0);
-		lander->velocity = (yNormal.dot(-lander->velocity) * yNormal) * 1.25;
-
-		// Check if lander is on the lander area
-		if (gamestate == INGAME) {
-			// Explode if lander is too fast
-			if (lander->velocity.length() >= 2.5f) {
-				explosionForce->applied = false;
-				explosionEmitter->position = lander->getPosition();
-				explosionEmitter->start();
-				shipExploded = true;
-				explosionSound.play();
-				gamestate = ENDGAME;
-			}
+// Copy what draw() needs out of the simulation and hand it to the main thread
+void ofApp::publishFrame() {
+	SimFrame& f = simFrames.getBack();
+	f.state = sim.state;
+	f.tick = sim.tick;
+
+	f.landerPosition = sim.lander.getPosition();
+	f.landerRotation = sim.lander.getRotationAngle();
+	f.landerForward = sim.lander.getForwardUV();
+	f.landerHandle = sim.lander.getBounds(0.5f);
+	f.collisionBoxes = sim.collisionBoxes;
+	f.bThrusting = sim.isThrusting();
+
+	f.fuel = sim.fuel;
+	f.score = sim.score;
+	f.shipExploded = sim.shipExploded;
+	for (int i = 0; i < 3; i++) {
+		f.areaLanded[i] = sim.areaLanded[i];
+	}
+	f.nearestArea = sim.getNearestArea();
+
+	jobs.add("frame agl", [this, &f] { f.agl = computeAGL(); });
+	jobs.add("frame particles", [this, &f] {
+		f.particles.clear();
+		ParticleRenderer::gather(sim.particleSys, sim.emitter.particleRadius, (float)sim.time, f.particles);
+		ParticleRenderer::gather(sim.explosionParticleSys, sim.explosionEmitter.particleRadius, (float)sim.time, f.particles);
+	});
+	jobs.run();
+
+	f.sensorReadings = sensors.readings;
+	f.sensorRays = sensors.rays;
+	f.sensorLevels = sensors.levels;
+	f.sensorMicros = sensors.lastMicros;
+
+	f.bAutopilot = bAutopilot;
+	f.autopilotTarget = autopilot.getTarget();
+	f.bReplayDone = bReplaying && player.isDone();
+
+	simFrames.publish();
+}
 
-			// Check if lander successfully landed
-			if (lander->velocity.length() < 1.5f) {
-				Vector3 la1 = Vector3(landingArea1.x, landingArea1.y, landingArea1.z);
-				Vector3 la2 = Vector3(landingArea2.x, landingArea2.y, landingArea2.z);
-				Vector3 la3 = Vector3(landingArea3.x, landingArea3.y, landingArea3.z);
-
-				if (!area1Landed && bounds.inside(la1)) {
-					area1Landed = true;
-					score += 10;
-					dingSound.play();
-					landingArea1Light.setDiffuseColor(ofColor::green);
-				}
-				else if (!area2Landed && bounds.inside(la2)) {
-					area2Landed = true;
-					score += 10;
-					dingSound.play();
-					landingArea2Light.setDiffuseColor(ofColor::green);
-				}
-				else if (!area3Landed && bounds.inside(la3)) {
-					area3Landed = true;
-					score += 10;
-					dingSound.play();
-					landingArea3Light.setDiffuseColor(ofColor::green);
-				}
-			}
-		}
+// Queue a request for the simulation thread
+void ofApp::sendCommand(SimCommandType type, float value, ofVec3f offset) {
+	SimCommand command;
+	command.type = type;
+	command.value = value;
+	command.offset = offset;
+	if (!simCommands.push(command)) {
+		cout << "Error: Simulation command queue is full" << endl;
 	}
-	
 }
 
 //--------------------------------------------------------------
 void ofApp::draw(){
+	if (frame->state == LOADING) {
+		drawLoadingScreen();
+		return;
+	}
+
 	ofEnableDepthTest();
 
 	// draw background image
@@ -496,7 +792,7 @@ void ofApp::draw(){
 		ofPopMatrix();
 	}
 
-	loadVbo();
+	loadParticles();
 
 	// Enable lighting
 	ofEnableLighting();
@@ -506,8 +802,18 @@ void ofApp::draw(){
 	ofPushMatrix();
 
 	// Draw LEM and the terrain
-	terrain.drawFaces();
-	lander->model.drawFaces();
+	if (bStreaming) {
+		terrainStreamer.draw(*theCam);
+	}
+	else {
+		terrainRenderer.draw(*theCam);
+	}
+	if (bLanderPacked) {
+		landerPack.drawFaces();
+	}
+	else {
+		landerModel.drawFaces();
+	}
 
 	if (bDisplayPoints) {                
 		// display points as an option    
@@ -521,20 +827,15 @@ void ofApp::draw(){
 	// draw shaded particles
 	glDepthMask(GL_FALSE);
 
-	ofSetColor(255, 100, 90);
-
-	ofEnableBlendMode(OF_BLENDMODE_ADD);
-	ofEnablePointSprites();
-
-	shader.begin();
-
-	particleTexture.bind();
-	vbo.draw(GL_POINTS, 0, (int)(emitter->sys->particles.size() + explosionEmitter->sys->particles.size()));
-	particleTexture.unbind();
+	if (bAlphaParticles) {
+		ofEnableBlendMode(OF_BLENDMODE_ALPHA);
+	}
+	else {
+		ofEnableBlendMode(OF_BLENDMODE_ADD);
+	}
 
-	shader.end();
+	particleRenderer.draw(particleTexture, ofColor(255, 100, 90));
 
-	ofDisablePointSprites();
 	ofDisableBlendMode();
 	//ofEnableAlphaBlending();
 
@@ -543,10 +844,8 @@ void ofApp::draw(){
 	// Draw lander and collision boxes
 	ofNoFill();
 
-	if (gamestate == PREGAME) {
-		ofVec3f min = lander->model.getSceneMin() * 0.5 + lander->getPosition();
-		ofVec3f max = lander->model.getSceneMax() * 0.5 + lander->getPosition();
-		Box bounds = Box(Vector3(min.x, min.y, min.z), Vector3(max.x, max.y, max.z));
+	if (frame->state == PREGAME) {
+		Box bounds = frame->landerHandle;
 		ofSetColor(ofColor::white);
 		if (bLanderSelected) {
 			ofSetColor(ofColor::red);
@@ -554,11 +853,23 @@ void ofApp::draw(){
 		Octree::drawBox(bounds);
 
 		ofSetColor(ofColor::lightBlue);
-		for (int i = 0; i < colBoxList.size(); i++) {
-			Octree::drawBox(colBoxList[i]);
+		for (int i = 0; i < frame->collisionBoxes.size(); i++) {
+			Octree::drawBox(frame->collisionBoxes[i]);
+		}
+	}
+
+	// Draw the sensor rays of the last scan out to what they hit
+	if (showSensors && frame->state == INGAME) {
+		// The lidar fan and the ground ray; the slope rays sit right next to the latter
+		for (int i = 0; i <= sensors.numLidarRays; i++) {
+			const Ray& ray = frame->sensorRays[i];
+			float d = frame->sensorReadings[i]; // the ground reading follows the lidar's
+			ofSetColor(d < sensors.range ? ofColor::orange : ofColor::gray);
+			Vector3 end = ray.origin + ray.direction * d;
+			ofDrawLine(ray.origin, end);
 		}
 	}
-	
+
 
 	ofPopMatrix();
 
@@ -572,14 +883,39 @@ void ofApp::draw(){
 
 	if (showAGL) {
 		ofSetColor(ofColor::white);
-		ofDrawBitmapString("Altitude (AGL): " + std::to_string(computeAGL()), 5, 15);
+		ofDrawBitmapString("Altitude (AGL): " + std::to_string(frame->agl), 5, 15);
+	}
+
+	if (showProfiler) {
+		ofSetColor(ofColor::white);
+		Profiler::get().draw(5, 30);
 	}
 
 	ofSetColor(ofColor::white);
-	ofDrawBitmapString("Fuel left: " + std::to_string(fuel), ofGetWindowWidth() - 170, 30);
-	ofDrawBitmapString("Score: " + std::to_string(score), ofGetWindowWidth() - 170, 45);
+	ofDrawBitmapString("Fuel left: " + std::to_string(frame->fuel), ofGetWindowWidth() - 170, 30);
+	ofDrawBitmapString("Score: " + std::to_string(frame->score), ofGetWindowWidth() - 170, 45);
+
+	if (showSensors) {
+		const float* slope = &frame->sensorReadings[sensors.getSlopeOffset()];
+		int area = frame->nearestArea;
+		ofSetColor(ofColor::white);
+		ofDrawBitmapString("Ground slope: " + ofToString(slope[0], 1) + " deg", 5, 45);
+		if (area >= 0) {
+			ofDrawBitmapString("Area " + ofToString(area + 1) + ": " + ofToString(frame->sensorReadings[sensors.getAreaOffset(area) + 3], 1) + " m", 5, 60);
+		}
+		ofDrawBitmapString("Sensor scan: " + ofToString(frame->sensorMicros, 0) + " us, depth " + ofToString(frame->sensorLevels), 5, 75);
+	}
+
+	if (frame->bAutopilot) {
+		string target = frame->autopilotTarget < 0 ? "none" : ofToString(frame->autopilotTarget + 1);
+		ofDrawBitmapString("Autopilot: area " + target, ofGetWindowWidth() - 170, 75);
+	}
 
-	if (gamestate == PREGAME) {
+	if (bReplaying) {
+		ofDrawBitmapString("Replay x" + ofToString(replaySpeed) + (frame->bReplayDone ? " (done)" : ""), ofGetWindowWidth() - 170, 60);
+	}
+
+	if (frame->state == PREGAME) {
 		string startText = "Press 'SPACEBAR' to start\n";
 		const string longestLine = "You can drag the ship around before starting the game\n";
 		startText += longestLine;
@@ -589,20 +925,20 @@ void ofApp::draw(){
 			ofGetWindowHeight() / 2
 		);
 	}
-	else if (gamestate == ENDGAME) {
+	else if (frame->state == ENDGAME) {
 		string endText;
-		if (shipExploded) {
+		if (frame->shipExploded) {
 			endText += "Your ship exploded!\n";
 		}
-		else if (fuel <= 0) {
+		else if (frame->fuel <= 0) {
 			endText += "Your ship ran out of fuel!\n";
 		}
 		else {
 			endText += "You win!\n";
 		}
-		endText += "Your score is " + ofToString(score) + ".\n";
-		if (fuel >= 0) {
-			endText += "Your remaining fuel is " + ofToString(fuel) + ".\n";
+		endText += "Your score is " + ofToString(frame->score) + ".\n";
+		if (frame->fuel >= 0) {
+			endText += "Your remaining fuel is " + ofToString(frame->fuel) + ".\n";
 		}
 		endText += "Press P to play again.";
 		textDisplay.drawString(
@@ -615,21 +951,63 @@ void ofApp::draw(){
 	ofDisableDepthTest();
 }
 
+// Progress bar shown while the assets load
+void ofApp::drawLoadingScreen() {
+	ofBackground(0);
+
+	float w = ofGetWindowWidth() / 2;
+	float x = ofGetWindowWidth() / 4;
+	float y = ofGetWindowHeight() / 2;
+
+	ofSetColor(ofColor::white);
+	ofDrawBitmapString("Loading... " + loader.getCurrentTask(), x, y - 10);
+
+	ofFill();
+	ofDrawRectangle(x, y, w * loader.getProgress(), 20);
+	ofNoFill();
+	ofDrawRectangle(x, y, w, 20);
+}
+
 //--------------------------------------------------------------
 void ofApp::keyPressed(int key){
 	keymap[key] = true;
+	keyInput = getInput();
 
-	if (gamestate == PREGAME && key == ' ') {
-		gamestate = INGAME;
+	// Nothing to control until the scene is set up
+	if (frame->state == LOADING) {
+		return;
+	}
+
+	if (bReplaying) {
+		// Restart the replay, or change its speed
+		if (key == 'p' || key == 'P') {
+			sendCommand(SimRestartReplay);
+		}
+		if (key == '[') {
+			replaySpeed = max(replaySpeed / 2, 0.125f);
+			sendCommand(SimReplaySpeed, replaySpeed);
+		}
+		if (key == ']') {
+			replaySpeed = min(replaySpeed * 2, 64.0f);
+			sendCommand(SimReplaySpeed, replaySpeed);
+		}
 	}
+	else {
+		if (frame->state == PREGAME && key == ' ') {
+			sendCommand(SimStartFlight);
+		}
+
+		if (frame->state != PREGAME && (key == 'p' || key == 'P')) {
+			sendCommand(SimResetFlight);
+		}
+
+		if (key == OF_KEY_BACKSPACE) {
+			sendCommand(SimRewind, 1);
+		}
 
-	if (gamestate != PREGAME && (key == 'p' || key == 'P')) {
-		gamestate = PREGAME;
-		// Reset lander and emitter positions, and variables
-		free(lander);
-		setupLander();
-		fuel = 120;
-		score = 0;
+		if (key == 'o' || key == 'O') {
+			sendCommand(SimToggleAutopilot);
+		}
 	}
 
 	switch (key) {
@@ -649,7 +1027,7 @@ void ofApp::keyPressed(int key){
 		break;
 	case 'r':
 		freeCam.reset();
-		freeCam.setTarget(lander->getPosition());
+		freeCam.setTarget(frame->landerPosition);
 		freeCam.setDistance(10);
 		freeCam.setNearClip(.1);
 		freeCam.setFov(65.5);   // approx equivalent to 28mm in 35mm format
@@ -658,7 +1036,20 @@ void ofApp::keyPressed(int key){
 	case 'g':
 		savePicture();
 		break;
+	case 'T':
 	case 't':
+		// Toggle displaying frame timings
+		showProfiler = !showProfiler;
+		break;
+	case 'B':
+	case 'b':
+		// Toggle between additive and depth-sorted alpha blended particles
+		bAlphaParticles = !bAlphaParticles;
+		break;
+	case 'L':
+	case 'l':
+		// Toggle showing the sensor readings
+		showSensors = !showSensors;
 		break;
 	case 'u':
 		break;
@@ -698,9 +1089,15 @@ void ofApp::keyPressed(int key){
 void ofApp::keyReleased(int key){
 	// Reset thrust-force in case user stopped pressing a movement key
 	keymap[key] = false;
+	keyInput = getInput();
+
+	if (frame->state == LOADING) {
+		return;
+	}
 
-	// Stop emitter in case user stopped pressing a movement key
-	emitter->stop();
+	if (key == OF_KEY_BACKSPACE && !bReplaying) {
+		sendCommand(SimRewind, 0);
+	}
 
 	switch (key) {
 	case OF_KEY_ALT:
@@ -730,21 +1127,11 @@ void ofApp::mouseDragged(int x, int y, int button){
 	}
 
 	if (bInDrag) {
-		glm::vec3 landerPos = lander->getPosition();
-
-		glm::vec3 mousePos = getMousePointOnPlane(landerPos, theCam->getZAxis());
+		glm::vec3 mousePos = getMousePointOnPlane(frame->landerPosition, theCam->getZAxis());
 		glm::vec3 delta = mousePos - mouseLastPos;
 
-		landerPos += delta;
-		lander->setPosition(ofVec3f(landerPos.x, landerPos.y, landerPos.z));
+		sendCommand(SimMoveLander, 0, ofVec3f(delta.x, delta.y, delta.z));
 		mouseLastPos = mousePos;
-
-		ofVec3f min = lander->model.getSceneMin() * 0.5 + lander->getPosition();
-		ofVec3f max = lander->model.getSceneMax() * 0.5 + lander->getPosition();
-		Box bounds = Box(Vector3(min.x, min.y, min.z), Vector3(max.x, max.y, max.z));
-
-		colBoxList.clear();
-		octree.intersect(bounds, octree.root, colBoxList);
 	}
 }
 
@@ -756,21 +1143,19 @@ void ofApp::mousePressed(int x, int y, int button){
 	}
 
 	// Allow lander selection only in PREGAME state
-	if (gamestate == PREGAME) {
+	if (frame->state == PREGAME && !bReplaying) {
 		glm::vec3 origin = theCam->getPosition();
 		glm::vec3 mouseWorld = theCam->screenToWorld(glm::vec3(mouseX, mouseY, 0));
 		glm::vec3 mouseDir = glm::normalize(mouseWorld - origin);
 
-		ofVec3f min = lander->model.getSceneMin() * 0.5 + lander->getPosition();
-		ofVec3f max = lander->model.getSceneMax() * 0.5 + lander->getPosition();
-		Box bounds = Box(Vector3(min.x, min.y, min.z), Vector3(max.x, max.y, max.z));
+		Box bounds = frame->landerHandle;
 
 		bLanderSelected = bounds.intersect(
-			Ray(Vector3(origin.x, origin.y, origin.z), Vector3(mouseDir.x, mouseDir.y, mouseDir.z)), 0, 1 << 20
+			Ray(origin, mouseDir), 0, 1 << 20
 		);
 
 		if (bLanderSelected) {
-			mouseDownPos = getMousePointOnPlane(lander->getPosition(), theCam->getZAxis());
+			mouseDownPos = getMousePointOnPlane(frame->landerPosition, theCam->getZAxis());
 			mouseLastPos = mouseDownPos;
 			bInDrag = true;
 		}
@@ -876,14 +1261,11 @@ void ofApp::savePicture() {
 }
 
 void ofApp::exit() {
-	free(thrustForce);
-	free(tanForce);
-	free(particleForce);
-	free(turbForce);
-	free(gravityForce);
-	free(emitter);
-	free(particleSys);
-	free(explosionEmitter);
-	free(explosionParticleSys);
-	free(lander);
+	if (simThread.joinable()) {
+		bStopSim = true;
+		simThread.join();
+	}
+
+	// Keep the recording of a flight that is still going
+	endFlight();
 }
\ No newline at end of file
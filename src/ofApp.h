@@ -8,42 +8,128 @@
 
 #include "ofMain.h"
 #include "Force.h"
-#include "LunarLander.h"
-#include "ParticleEmitter.h"
+#include "Simulation.h"
+#include "FlightRecorder.h"
+#include "Autopilot.h"
+#include "Sensors.h"
+#include "TelemetryLog.h"
+#include "SimFrame.h"
+#include "TripleBuffer.h"
+#include "JobSystem.h"
+#include "ofxAssimpModelLoader.h"
+#include "ParticleRenderer.h"
 #include "Octree.h"
+#include "TerrainRenderer.h"
+#include "TerrainTiles.h"
 #include "Util.h"
+#include "PackedModel.h"
+#include "Profiler.h"
+#include "AssetLoader.h"
 #include <glm/gtx/intersect.hpp>
 #include "ofxGui.h"
 
-// State of the game
-enum GameState {
-	PREGAME, INGAME, ENDGAME
-};
-
-// Decide which models to load
-enum GameEnv {
-	MOON, DESERT
-};
-
 class ofApp : public ofBaseApp{
 private:
 	float computeAGL();
 	bool showAGL = true;
+	bool showProfiler = false;
 
 	Octree octree;
-	TreeNode selectedNode;
+	Heightfield terrainHeightfield;
+	NodeHandle selectedNode;
 	Box boundingBox, landerBounds;
 
 	bool bLanderSelected = false;
 	glm::vec3 mouseDownPos, mouseLastPos;
 	bool bInDrag = false;
 
-	vector<Box> colBoxList;
-
 	void setupLander();
+	void setupScene();
+	void openTerrainTiles(const string& tilesPath);
+	uint32_t getInput();
+	void startFlight();
+	void endFlight();
+	void logTelemetry(uint32_t input);
+	void sendCommand(SimCommandType type, float value = 0, ofVec3f offset = ofVec3f());
+	void buildTerrain(const string& tilesPath);
+	void loadTerrainMaterial();
+	void drawLoadingScreen();
+
+	// Start-up asset loading
+	AssetLoader loader;
+	ofPixels backgroundPixels;
+	ofPixels particlePixels;
+	bool bParticlePixelsLoaded = false;
+	bool bTilesBakeOk = false;
+
+	// Terrain baked by tools/meshpack, loaded instead of going through Assimp
+	bool bTerrainPacked = false;
+	bool bTerrainPackOk = false;
+	MeshPart terrainPart; // the terrain's material and texture
+	ofPixels terrainTexturePixels;
+	ofMaterial terrainMaterial;
+	ofTexture terrainTexture;
 
 	GameEnv gameEnv = DESERT; // Change game environment (options: MOON, DESERT)
+
+	// Stream the terrain from tiles baked next to the terrain file (baked on first run)
+	bool bStreamTerrain = false;
+	size_t terrainMemoryBudget = 256 * 1024 * 1024;
+	bool bStreaming = false;
+	TerrainStreamer terrainStreamer;
+
+	// The game itself, stepped at a fixed rate on a thread of its own. Once that
+	// thread is started it owns sim and everything down to the autopilot below;
+	// the main thread only sends it commands and draws the frames it publishes.
+	Simulation sim;
+	JobSystem jobs; // spreads each tick, and the frame after it, over the cores
+	thread simThread;
+	atomic<bool> bStopSim{ false };
+	const int maxCatchUpSteps = 256;
+	void simThreadedFunction();
+	void runCommand(const SimCommand& command);
+	void stepSimulation();
+	void publishFrame();
+
+	SpscRing<SimCommand> simCommands;
+	float simReplaySpeed = 1.0f;       // replaySpeed, as the simulation thread has it
+	atomic<uint32_t> keyInput{ 0 };    // the flight controls held down, from getInput()
+	atomic<uint32_t> simEvents{ 0 };   // raised since update() last took them
+	TripleBuffer<SimFrame> simFrames;
+	const SimFrame* frame = NULL;      // the newest one, taken at the start of update()
+
+	// Every flight is recorded to data/recordings for replay
+	string terrainPath;
+	uint64_t terrainHash = 0; // hashMesh() of terrainMesh, for flight recordings
+	bool bRecordFlights = true;
+	FlightRecorder recorder;
+	FlightPlayer player;
+	bool bReplaying = false;
+
+	// Every tick of every flight is logged to data/telemetry
+	bool bTelemetry = true;
+	TelemetryWriter telemetry;
+	string telemetryPath; // of the flight being logged
+	ofVec3f telemetryVelocity; // at the last tick logged
+
+	// The last few seconds of the flight, for rewinding with BACKSPACE
+	SnapshotRing rewindRing;
+	const float rewindSeconds = 10;
+	bool bRewinding = false;
+	uint64_t flightStartTick = 0;
+
+	// The lander's sensors, read every tick; L shows them
+	SensorSuite sensors;
+	bool showSensors = false;
+
+	// Flies the lander instead of the player when switched on with O
+	Autopilot autopilot;
+	bool bAutopilot = false;
 public:
+	// Flight to replay instead of playing, set from the command line
+	string replayPath;
+	float replaySpeed = 1.0f;
+
 	void setup();
 	void update();
 	void draw();
@@ -68,8 +154,12 @@ public:
 
 	glm::vec3 getMousePointOnPlane(glm::vec3 p, glm::vec3 n);
 
-	LunarLander* lander;
+	ofxAssimpModelLoader landerModel;
+	PackedModel landerPack; // drawn instead of landerModel when the lander is packed
+	bool bLanderPacked = false;
 	ofxAssimpModelLoader terrain;
+	ofMesh terrainMesh; // the octree references its vertices
+	TerrainRenderer terrainRenderer;
 	ofLight light;
 	ofImage backgroundImage;
 
@@ -87,47 +177,8 @@ public:
 
 	bool bBackgroundLoaded = false;
 
-	GameState gamestate = PREGAME;
 	ofTrueTypeFont textDisplay;
 
-	// Thrust force
-	ThrustForce* thrustForce;
-	float thrustMagnitude = 90.0f;
-
-	// Tangential force
-	TangentialForce* tanForce;
-	float torqueMagnitude = 6000.0f;
-
-	// Turbulence force
-	TurbulenceForce* turbForce;
-
-	// Gravity force
-	GravityForce* gravityForce;
-	float gravity = 1.64f;
-
-	// Particle forces
-	ThrustForce* particleForce;
-	float particleThrust = 35.0f;
-
-	ImpulseRadialForce* explosionForce;
-	float explosionMagnitude = 1400.0f;
-
-	// Particles
-	ParticleEmitter* emitter;
-	ParticleSystem* particleSys;
-
-	ParticleEmitter* explosionEmitter;
-	ParticleSystem* explosionParticleSys;
-
-	// LEM fuel
-	float fuel = 120;
-
-	int score = 0;
-
-	ofVec3f landingArea1 = ofVec3f(30, 0.5, -30); // Flat area
-	ofVec3f landingArea2 = ofVec3f(-132, 21.5, 36.3); // Mountain area
-	ofVec3f landingArea3 = ofVec3f(-25, 10, 90.7); // Inclined area
-
 	// Lighting
 	ofLight ambientLight;
 
@@ -137,16 +188,11 @@ public:
 
 	ofLight landerLight;
 
-	bool area1Landed = false;
-	bool area2Landed = false;
-	bool area3Landed = false;
-	bool shipExploded = false;
-
 	// Particle System Shades
 	ofTexture particleTexture;
-	ofVbo vbo;
-	ofShader shader;
-	void loadVbo();
+	ParticleRenderer particleRenderer;
+	bool bAlphaParticles = false;
+	void loadParticles();
 
 	map<int, bool> keymap;
 
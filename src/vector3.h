@@ -2,41 +2,106 @@
 #define _VECTOR3_H_
 
 #include <math.h>
+#include <utility>
+#include <glm/vec3.hpp>
 
-class Vector3 {
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define VECTOR3_SSE
+#endif
+
+/*
+ * Vector3 is the vector type of the geometry code (Box, Ray, Octree). It is
+ * padded to four floats and 16 byte aligned, so it loads into an SSE register
+ * in one instruction and its arithmetic works on all components at once; the
+ * fourth component is always zero.
+ *
+ * It converts implicitly from glm::vec3 and from anything else with x, y and z
+ * members (ofVec3f, ofPoint), and back to glm::vec3, so mesh vertices and the
+ * physics' vectors go into boxes and rays as they are.
+ *
+ * The physics stays on ofVec3f on purpose. Recorded flights and rewinds rely on
+ * every build stepping the lander to the same bits, and Vector3 does not: its
+ * SSE dot product and length sum in a different order than the scalar fallback.
+ * The simulation also only moves a few vectors per tick, too few to gain from SSE.
+ */
+class alignas(16) Vector3 {
 public:
-    Vector3() { };
-    Vector3(float x, float y, float z) { d[0] = x; d[1] = y; d[2] = z; }
-    Vector3(const Vector3& v)
-    {
-        d[0] = v.d[0]; d[1] = v.d[1]; d[2] = v.d[2];
-    }
+    Vector3() : d{ 0, 0, 0, 0 } { }
+    Vector3(float x, float y, float z) : d{ x, y, z, 0 } { }
+    Vector3(const glm::vec3& v) : d{ v.x, v.y, v.z, 0 } { }
+    template <typename V, typename = decltype(std::declval<const V&>().z)>
+    Vector3(const V& v) : d{ v.x, v.y, v.z, 0 } { }
+
+    operator glm::vec3() const { return glm::vec3(d[0], d[1], d[2]); }
+
+#ifdef VECTOR3_SSE
+    explicit Vector3(__m128 m) { _mm_store_ps(d, m); }
+    __m128 simd() const { return _mm_load_ps(d); }
+#endif
 
     float x() const { return d[0]; }
     float y() const { return d[1]; }
     float z() const { return d[2]; }
 
     float operator[](int i) const { return d[i]; }
+    const float* data() const { return d; }
 
     float length() const
     {
-        return sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+        return sqrt(*this * *this);
     }
     void normalize() {
         float temp = length();
         if (temp == 0.0)
             return;	// 0 length vector
         // multiply by 1/magnitude
-        temp = 1 / temp;
-        d[0] *= temp;
-        d[1] *= temp;
-        d[2] *= temp;
+        *this *= 1 / temp;
     }
 
     /////////////////////////////////////////////////////////
     // Overloaded operators
     /////////////////////////////////////////////////////////
 
+#ifdef VECTOR3_SSE
+    Vector3 operator+(const Vector3& op2) const {   // vector addition
+        return Vector3(_mm_add_ps(simd(), op2.simd()));
+    }
+    Vector3 operator-(const Vector3& op2) const {   // vector subtraction
+        return Vector3(_mm_sub_ps(simd(), op2.simd()));
+    }
+    Vector3 operator-() const {                    // unary minus
+        return Vector3(_mm_sub_ps(_mm_setzero_ps(), simd()));
+    }
+    Vector3 operator*(float s) const {            // scalar multiplication
+        return Vector3(_mm_mul_ps(simd(), _mm_set1_ps(s)));
+    }
+    void operator*=(float s) {
+        _mm_store_ps(d, _mm_mul_ps(simd(), _mm_set1_ps(s)));
+    }
+    Vector3 operator/(float s) const {            // scalar division
+        return *this * (1 / s);
+    }
+    float operator*(const Vector3& op2) const {   // dot product
+        __m128 m = _mm_mul_ps(simd(), op2.simd());
+        m = _mm_add_ps(m, _mm_movehl_ps(m, m));
+        m = _mm_add_ss(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 1, 1, 1)));
+        return _mm_cvtss_f32(m);
+    }
+    bool operator==(const Vector3& op2) const {
+        return (_mm_movemask_ps(_mm_cmpeq_ps(simd(), op2.simd())) & 7) == 7;
+    }
+    bool operator<(const Vector3& op2) const {
+        return (_mm_movemask_ps(_mm_cmplt_ps(simd(), op2.simd())) & 7) == 7;
+    }
+    bool operator<=(const Vector3& op2) const {
+        return (_mm_movemask_ps(_mm_cmple_ps(simd(), op2.simd())) & 7) == 7;
+    }
+
+    // Componentwise minimum and maximum
+    static Vector3 min(const Vector3& a, const Vector3& b) { return Vector3(_mm_min_ps(a.simd(), b.simd())); }
+    static Vector3 max(const Vector3& a, const Vector3& b) { return Vector3(_mm_max_ps(a.simd(), b.simd())); }
+#else
     Vector3 operator+(const Vector3& op2) const {   // vector addition
         return Vector3(d[0] + op2.d[0], d[1] + op2.d[1], d[2] + op2.d[2]);
     }
@@ -60,16 +125,9 @@ public:
     float operator*(const Vector3& op2) const {   // dot product
         return d[0] * op2.d[0] + d[1] * op2.d[1] + d[2] * op2.d[2];
     }
-    Vector3 operator^(const Vector3& op2) const {   // cross product
-        return Vector3(d[1] * op2.d[2] - d[2] * op2.d[1], d[2] * op2.d[0] - d[0] * op2.d[2],
-            d[0] * op2.d[1] - d[1] * op2.d[0]);
-    }
     bool operator==(const Vector3& op2) const {
         return (d[0] == op2.d[0] && d[1] == op2.d[1] && d[2] == op2.d[2]);
     }
-    bool operator!=(const Vector3& op2) const {
-        return (d[0] != op2.d[0] || d[1] != op2.d[1] || d[2] != op2.d[2]);
-    }
     bool operator<(const Vector3& op2) const {
         return (d[0] < op2.d[0] && d[1] < op2.d[1] && d[2] < op2.d[2]);
     }
@@ -77,8 +135,24 @@ public:
         return (d[0] <= op2.d[0] && d[1] <= op2.d[1] && d[2] <= op2.d[2]);
     }
 
+    // Componentwise minimum and maximum
+    static Vector3 min(const Vector3& a, const Vector3& b) {
+        return Vector3(fminf(a.d[0], b.d[0]), fminf(a.d[1], b.d[1]), fminf(a.d[2], b.d[2]));
+    }
+    static Vector3 max(const Vector3& a, const Vector3& b) {
+        return Vector3(fmaxf(a.d[0], b.d[0]), fmaxf(a.d[1], b.d[1]), fmaxf(a.d[2], b.d[2]));
+    }
+#endif
+    Vector3 operator^(const Vector3& op2) const {   // cross product
+        return Vector3(d[1] * op2.d[2] - d[2] * op2.d[1], d[2] * op2.d[0] - d[0] * op2.d[2],
+            d[0] * op2.d[1] - d[1] * op2.d[0]);
+    }
+    bool operator!=(const Vector3& op2) const {
+        return !(*this == op2);
+    }
+
 private:
-    float d[3];
+    float d[4];
 };
 
 #endif // _VECTOR3_H_
@@ -0,0 +1,143 @@
+// meshpack - bake a model into the MeshPack format loaded by the game
+//
+//   meshpack <model> [output] [mesh index]
+//
+// The output defaults to <model>.llmesh, which is where the game looks for it.
+// The model goes through the same Assimp post-processing as ofxAssimpModelLoader
+// so the packed mesh matches what the game would have loaded.
+//
+// Without a mesh index every mesh of the model is packed, each as a part with
+// its own material and texture, and the model's node transforms are baked into
+// the vertices. That is how models drawn whole, like the lander, are packed. A
+// terrain is packed with its mesh index (normally 0), since the game only uses
+// that one mesh of it.
+
+#include "MeshPack.h"
+#include <assimp/cimport.h>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+
+static void getColor(const aiMaterial* material, const char* key, unsigned int type, unsigned int index,
+	const float* fallback, float* rgba) {
+	aiColor4D c;
+	if (aiGetMaterialColor(material, key, type, index, &c) == AI_SUCCESS) {
+		rgba[0] = c.r;
+		rgba[1] = c.g;
+		rgba[2] = c.b;
+		rgba[3] = c.a;
+	}
+	else {
+		memcpy(rgba, fallback, 4 * sizeof(float));
+	}
+}
+
+// Append one mesh to data as a part drawn with its material
+static void addMesh(const aiScene* scene, const aiMesh* mesh, const string& modelPath, MeshPackData& data,
+	bool bNormals, bool bTexCoords) {
+	uint32_t firstVertex = (uint32_t)(data.positions.size() / 3);
+	for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
+		const aiVector3D& v = mesh->mVertices[i];
+		data.positions.insert(data.positions.end(), { v.x, v.y, v.z });
+		if (bNormals) {
+			aiVector3D n = mesh->HasNormals() ? mesh->mNormals[i] : aiVector3D(0, 1, 0);
+			data.normals.insert(data.normals.end(), { n.x, n.y, n.z });
+		}
+		if (bTexCoords) {
+			aiVector3D t = mesh->HasTextureCoords(0) ? mesh->mTextureCoords[0][i] : aiVector3D(0, 0, 0);
+			data.texcoords.insert(data.texcoords.end(), { t.x, t.y });
+		}
+	}
+
+	MeshPackSubmesh part;
+	memset(&part, 0, sizeof(part));
+	part.firstIndex = (uint32_t)data.indices.size();
+	for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
+		const aiFace& face = mesh->mFaces[i];
+		if (face.mNumIndices != 3) continue; // points and lines left by triangulation
+		for (int k = 0; k < 3; k++) {
+			data.indices.push_back(firstVertex + face.mIndices[k]);
+		}
+	}
+	part.numIndices = (uint32_t)data.indices.size() - part.firstIndex;
+
+	// The same defaults ofMaterial starts with
+	static const float defaultDiffuse[4] = { 0.8f, 0.8f, 0.8f, 1 };
+	static const float defaultAmbient[4] = { 0.2f, 0.2f, 0.2f, 1 };
+	static const float black[4] = { 0, 0, 0, 1 };
+	const aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
+	getColor(material, AI_MATKEY_COLOR_DIFFUSE, defaultDiffuse, part.diffuse);
+	getColor(material, AI_MATKEY_COLOR_AMBIENT, defaultAmbient, part.ambient);
+	getColor(material, AI_MATKEY_COLOR_SPECULAR, black, part.specular);
+	getColor(material, AI_MATKEY_COLOR_EMISSIVE, black, part.emissive);
+	float shininess = 0;
+	if (aiGetMaterialFloat(material, AI_MATKEY_SHININESS, &shininess) == AI_SUCCESS) {
+		part.shininess = shininess;
+	}
+
+	// Texture paths are stored relative to the model, the game loads them
+	// relative to the data folder
+	aiString texturePath;
+	if (material->GetTexture(aiTextureType_DIFFUSE, 0, &texturePath) == AI_SUCCESS) {
+		string dir = modelPath.substr(0, modelPath.find_last_of("/\\") + 1);
+		size_t dataDir = dir.rfind("data/");
+		if (dataDir != string::npos) dir = dir.substr(dataDir + 5);
+		string path = dir + texturePath.C_Str();
+		strncpy(part.texturePath, path.c_str(), sizeof(part.texturePath) - 1);
+	}
+	data.submeshes.push_back(part);
+}
+
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		cout << "usage: meshpack <model> [output] [mesh index]" << endl;
+		return 1;
+	}
+	string modelPath = argv[1];
+	string outPath = argc > 2 ? argv[2] : modelPath + ".llmesh";
+	bool bAllMeshes = argc <= 3;
+	unsigned int meshIndex = bAllMeshes ? 0 : atoi(argv[3]);
+
+	unsigned int flags = aiProcessPreset_TargetRealtime_MaxQuality | aiProcess_Triangulate | aiProcess_FlipUVs;
+	if (bAllMeshes) flags |= aiProcess_PreTransformVertices;
+	const aiScene* scene = aiImportFile(modelPath.c_str(), flags);
+	if (scene == NULL) {
+		cout << "Error: Can't load model " << modelPath << ": " << aiGetErrorString() << endl;
+		return 1;
+	}
+	if (meshIndex >= scene->mNumMeshes) {
+		cout << "Error: " << modelPath << " has no mesh " << meshIndex << endl;
+		aiReleaseImport(scene);
+		return 1;
+	}
+
+	unsigned int first = meshIndex;
+	unsigned int last = bAllMeshes ? scene->mNumMeshes : meshIndex + 1;
+
+	// Normals and texcoords are per vertex across all parts, so a part without
+	// them gets placeholders when another part has them
+	bool bNormals = false;
+	bool bTexCoords = false;
+	for (unsigned int m = first; m < last; m++) {
+		bNormals = bNormals || scene->mMeshes[m]->HasNormals();
+		bTexCoords = bTexCoords || scene->mMeshes[m]->HasTextureCoords(0);
+	}
+
+	MeshPackData data;
+	for (unsigned int m = first; m < last; m++) {
+		addMesh(scene, scene->mMeshes[m], modelPath, data, bNormals, bTexCoords);
+	}
+	aiReleaseImport(scene);
+
+	if (!writeMeshPack(outPath, data)) {
+		cout << "Error: Can't write " << outPath << endl;
+		return 1;
+	}
+	cout << outPath << ": " << data.positions.size() / 3 << " vertices, "
+		<< data.indices.size() / 3 << " triangles, " << data.submeshes.size() << " parts" << endl;
+	return 0;
+}
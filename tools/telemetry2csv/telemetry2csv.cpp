@@ -0,0 +1,48 @@
+// telemetry2csv - convert a telemetry log written by the game to CSV
+//
+//   telemetry2csv <log.lltm> [output.csv]
+//
+// The output defaults to <log>.csv. The first row holds the column names.
+
+#include "TelemetryLog.h"
+#include <iostream>
+#include <fstream>
+
+using namespace std;
+
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		cout << "usage: telemetry2csv <log.lltm> [output.csv]" << endl;
+		return 1;
+	}
+	string logPath = argv[1];
+	string outPath = argc > 2 ? argv[2] : logPath + ".csv";
+
+	TelemetryReader reader;
+	if (!reader.open(logPath)) return 1;
+
+	ofstream out(outPath);
+	if (!out) {
+		cout << "Error: Can't write " << outPath << endl;
+		return 1;
+	}
+
+	for (size_t c = 0; c < reader.columns.size(); c++) {
+		out << (c > 0 ? "," : "") << reader.columns[c].name;
+	}
+	out << "\n";
+
+	uint64_t numRows = 0;
+	while (reader.readBlock()) {
+		for (uint32_t i = 0; i < reader.numSamples; i++) {
+			for (size_t c = 0; c < reader.columns.size(); c++) {
+				out << (c > 0 ? "," : "") << reader.format((int)c, i);
+			}
+			out << "\n";
+		}
+		numRows += reader.numSamples;
+	}
+
+	cout << "Wrote " << numRows << " samples to " << outPath << endl;
+	return 0;
+}